@@ -0,0 +1,263 @@
+/*
+ * clusterTour.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <iostream>
+
+#include "clusterTour.h"
+#include "pointIndex.h"
+#include "se3graph.h"
+#include "tourImprovement.h"
+
+using namespace std;
+
+// seeds nearest by position a fiber compares with when clustering
+static const int SEED_CANDIDATES = 16;
+// clusters up to this many use the complete graph of representatives
+static const int DENSE_CLUSTER_LIMIT = 2000;
+static const int CLUSTER_NEIGHBOURS = 16;
+// position neighbours checked per fiber for the closest pair of two
+// clusters
+static const int BOUNDARY_CANDIDATES = 4;
+
+static void splitByPosition(const fiberSet &fibers, std::vector<int> &ids,
+		int clusterSize, std::vector<std::vector<int> > &clusters) {
+	// median splits along the widest axis until the parts are small
+	std::vector<std::pair<size_t, size_t> > stack(1,
+			std::make_pair(static_cast<size_t>(0), ids.size()));
+	while (!stack.empty()) {
+		size_t lo = stack.back().first, hi = stack.back().second;
+		stack.pop_back();
+		if (hi - lo <= static_cast<size_t>(clusterSize)) {
+			clusters.push_back(
+					std::vector<int>(ids.begin() + lo, ids.begin() + hi));
+			continue;
+		}
+		double mn[3], mx[3];
+		for (int a = 0; a < 3; a++) {
+			mn[a] = mx[a] = fibers.positionOf(ids[lo])[a];
+		}
+		for (size_t i = lo; i < hi; i++) {
+			const double *p = fibers.positionOf(ids[i]);
+			for (int a = 0; a < 3; a++) {
+				mn[a] = std::min(mn[a], p[a]);
+				mx[a] = std::max(mx[a], p[a]);
+			}
+		}
+		int axis = 0;
+		for (int a = 1; a < 3; a++) {
+			if (mx[a] - mn[a] > mx[axis] - mn[axis]) {
+				axis = a;
+			}
+		}
+		size_t mid = (lo + hi) / 2;
+		std::nth_element(ids.begin() + lo, ids.begin() + mid,
+				ids.begin() + hi, [&](int i, int j) {
+					return fibers.positionOf(i)[axis]
+							< fibers.positionOf(j)[axis];
+				});
+		stack.push_back(std::make_pair(lo, mid));
+		stack.push_back(std::make_pair(mid, hi));
+	}
+}
+
+static std::vector<std::vector<int> > clusterFibers(const fiberSet &fibers,
+		int clusterSize) {
+	// every fiber joins the closest (by fiber distance) of the seed fibers
+	// nearest to it by position, n / clusterSize seeds spread over the
+	// input; clusters that come out too large are split by position
+	int n = static_cast<int>(fibers.size());
+	int seeds = std::max(1, n / clusterSize);
+	std::vector<int> seed(seeds);
+	std::vector<double> seedPositions;
+	for (int k = 0; k < seeds; k++) {
+		seed[k] = static_cast<int>((static_cast<long>(k) * n) / seeds);
+		const double *p = fibers.positionOf(seed[k]);
+		seedPositions.insert(seedPositions.end(), p, p + 3);
+	}
+	pointIndex index(seedPositions);
+	int candidates = std::min(seeds, SEED_CANDIDATES);
+	std::vector<int> seedOf(n, 0);
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int f = 0; f < n; f++) {
+		std::vector<int> near = index.nearest(fibers.positionOf(f), candidates);
+		double best = -1;
+		for (size_t c = 0; c < near.size(); c++) {
+			double d = fibers.distance(f, seed[near[c]]);
+			if (best < 0 || d < best) {
+				best = d;
+				seedOf[f] = near[c];
+			}
+		}
+	}
+	std::vector<std::vector<int> > bySeed(seeds);
+	for (int f = 0; f < n; f++) {
+		bySeed[seedOf[f]].push_back(f);
+	}
+	std::vector<std::vector<int> > clusters;
+	for (int k = 0; k < seeds; k++) {
+		if (!bySeed[k].empty()) {
+			splitByPosition(fibers, bySeed[k], clusterSize, clusters);
+		}
+	}
+	return clusters;
+}
+
+static int representative(const fiberSet &fibers,
+		const std::vector<int> &cluster) {
+	// the fiber closest to the centroid of the cluster
+	double c[3] = { 0, 0, 0 };
+	for (size_t i = 0; i < cluster.size(); i++) {
+		for (int a = 0; a < 3; a++) {
+			c[a] += fibers.positionOf(cluster[i])[a];
+		}
+	}
+	int best = cluster[0];
+	double bestDistance = -1;
+	for (size_t i = 0; i < cluster.size(); i++) {
+		const double *p = fibers.positionOf(cluster[i]);
+		double d = 0;
+		for (int a = 0; a < 3; a++) {
+			double x = p[a] - c[a] / cluster.size();
+			d += x * x;
+		}
+		if (bestDistance < 0 || d < bestDistance) {
+			best = cluster[i];
+			bestDistance = d;
+		}
+	}
+	return best;
+}
+
+static std::vector<double> clusterPositions(const fiberSet &fibers,
+		const std::vector<int> &cluster) {
+	std::vector<double> xyz;
+	for (size_t i = 0; i < cluster.size(); i++) {
+		const double *p = fibers.positionOf(cluster[i]);
+		xyz.insert(xyz.end(), p, p + 3);
+	}
+	return xyz;
+}
+
+static void closestPair(const fiberSet &fibers, const std::vector<int> &a,
+		const std::vector<int> &b, const pointIndex &bIndex, int excludeA,
+		int excludeB, int &fa, int &fb) {
+	// closest fibers of two clusters, checking the nearest fibers of b by
+	// position for every fiber of a; a fiber already used as the other
+	// end of its cluster is skipped unless it is the only one
+	double best = -1;
+	int k = std::min(static_cast<int>(b.size()), BOUNDARY_CANDIDATES + 1);
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i] == excludeA && a.size() > 1) {
+			continue;
+		}
+		std::vector<int> near = bIndex.nearest(fibers.positionOf(a[i]), k);
+		for (size_t c = 0; c < near.size(); c++) {
+			int j = b[near[c]];
+			if (j == excludeB && b.size() > 1) {
+				continue;
+			}
+			double d = fibers.distance(a[i], j);
+			if (best < 0 || d < best) {
+				best = d;
+				fa = a[i];
+				fb = j;
+			}
+		}
+	}
+}
+
+static std::vector<int> clusterPath(const fiberSet &fibers,
+		const std::vector<int> &cluster, int entry, int exit) {
+	// walk of the cluster's MST from its entry to its exit fiber
+	int m = static_cast<int>(cluster.size());
+	if (m == 1) {
+		return cluster;
+	}
+	std::vector<fiber> members;
+	int from = 0, to = -1;
+	for (int i = 0; i < m; i++) {
+		members.push_back(fibers.states(cluster[i]));
+		if (cluster[i] == entry) {
+			from = i;
+		}
+		if (cluster[i] == exit) {
+			to = i;
+		}
+	}
+	fiberSet local(members, false);
+	std::vector<unsigned int> walk = mstPath(fiberGraph(local), local, from,
+			to);
+	std::vector<int> path(m);
+	for (int i = 0; i < m; i++) {
+		path[i] = cluster[walk[i]];
+	}
+	return path;
+}
+
+std::vector<unsigned int> solveClusteredTSP(const fiberSet &fibers,
+		int clusterSize) {
+	std::vector<unsigned int> tour;
+	int n = static_cast<int>(fibers.size());
+	if (n == 0) {
+		return tour;
+	}
+
+	// 1. clusters by fiber distance
+	std::vector<std::vector<int> > clusters = clusterFibers(fibers,
+			clusterSize);
+	int m = static_cast<int>(clusters.size());
+
+	// 2. cluster order from a tour of the representatives
+	std::vector<fiber> reps;
+	for (int c = 0; c < m; c++) {
+		reps.push_back(fibers.states(representative(fibers, clusters[c])));
+	}
+	fiberSet repSet(reps, false);
+	std::vector<unsigned int> repTour = mstTour(
+			m <= DENSE_CLUSTER_LIMIT ?
+					fiberGraph(repSet) :
+					knnFiberGraph(repSet, CLUSTER_NEIGHBOURS), repSet);
+	std::vector<int> order(repTour.begin(), repTour.end() - 1);
+
+	// 3. entry and exit fibers, the closest pair of consecutive clusters
+	std::vector<int> entries(m, -1), exits(m, -1);
+	if (m > 1) {
+		std::vector<pointIndex> index(m);
+#pragma omp parallel for schedule(dynamic)
+		for (int c = 0; c < m; c++) {
+			index[c] = pointIndex(clusterPositions(fibers, clusters[c]));
+		}
+		for (int t = 0; t < m; t++) {
+			int a = order[t], b = order[(t + 1) % m];
+			closestPair(fibers, clusters[a], clusters[b], index[b],
+					entries[a], exits[b], exits[a], entries[b]);
+		}
+	}
+
+	// 4. paths through the clusters, in parallel
+	std::vector<std::vector<int> > paths(m);
+#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < m; c++) {
+		paths[c] = clusterPath(fibers, clusters[c], entries[c], exits[c]);
+	}
+
+	// stitched in cluster order and closed at fiber 0
+	std::vector<int> cycle;
+	cycle.reserve(n);
+	for (int t = 0; t < m; t++) {
+		cycle.insert(cycle.end(), paths[order[t]].begin(),
+				paths[order[t]].end());
+	}
+	int zero = static_cast<int>(std::find(cycle.begin(), cycle.end(), 0)
+			- cycle.begin());
+	for (int i = 0; i <= n; i++) {
+		tour.push_back(cycle[(zero + i) % n]);
+	}
+	cout << m << " clusters, tour length " << tourLength(tour, fibers)
+			<< endl;
+	return tour;
+}
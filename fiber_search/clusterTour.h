@@ -0,0 +1,31 @@
+/*
+ * clusterTour.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef CLUSTERTOUR_H_
+#define CLUSTERTOUR_H_
+
+#include <vector>
+
+#include "fiberSet.h"
+
+/*
+ * Cluster first, route second tour for inputs too large for one graph.
+ * n / clusterSize seed fibers are spread over the input, and every fiber
+ * joins the seed closest to it by fiber distance (orientations included)
+ * among the seeds nearest to it by position; clusters that come out with
+ * more than clusterSize fibers are split at position medians. A tour over
+ * one representative fiber per cluster fixes the cluster order,
+ * consecutive clusters are joined at their closest pair of fibers, and
+ * every cluster is walked from its entry to its exit fiber along its own
+ * MST (mstPath), all clusters in parallel. The work is linear in the
+ * number of fibers for a fixed cluster size.
+ *
+ * The tour has the form of solveTSP's: closed, from fiber 0 back to it.
+ */
+std::vector<unsigned int> solveClusteredTSP(const fiberSet &fibers,
+		int clusterSize = 32);
+
+#endif /* CLUSTERTOUR_H_ */
@@ -0,0 +1,98 @@
+/*
+ * csrGraph.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+
+#include "csrGraph.h"
+
+csrGraph::csrGraph(int n, const std::vector<weightedEdge> &edges) :
+		n(n) {
+	// count, prefix sum, fill, then sort every row
+	offsets.assign(n + 1, 0);
+	for (size_t e = 0; e < edges.size(); e++) {
+		offsets[edges[e].u + 1]++;
+		offsets[edges[e].v + 1]++;
+	}
+	for (int u = 0; u < n; u++) {
+		offsets[u + 1] += offsets[u];
+	}
+	std::vector<std::pair<int, double> > row(offsets[n]);
+	std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	for (size_t e = 0; e < edges.size(); e++) {
+		row[next[edges[e].u]++] = std::make_pair(edges[e].v, edges[e].w);
+		row[next[edges[e].v]++] = std::make_pair(edges[e].u, edges[e].w);
+	}
+	// drop repeated edges while compacting
+	targets.reserve(row.size());
+	weights.reserve(row.size());
+	std::vector<size_t> start(n + 1, 0);
+	for (int u = 0; u < n; u++) {
+		start[u] = targets.size();
+		std::sort(row.begin() + offsets[u], row.begin() + offsets[u + 1]);
+		for (size_t i = offsets[u]; i < offsets[u + 1]; i++) {
+			if (i > offsets[u] && row[i].first == row[i - 1].first) {
+				continue;
+			}
+			targets.push_back(row[i].first);
+			weights.push_back(row[i].second);
+		}
+	}
+	start[n] = targets.size();
+	offsets.swap(start);
+}
+
+bool csrGraph::weight(int u, int v, double &w) const {
+	std::vector<int>::const_iterator lo = targets.begin() + offsets[u];
+	std::vector<int>::const_iterator hi = targets.begin() + offsets[u + 1];
+	std::vector<int>::const_iterator it = std::lower_bound(lo, hi, v);
+	if (it == hi || *it != v) {
+		return false;
+	}
+	w = weights[it - targets.begin()];
+	return true;
+}
+
+std::vector<weightedEdge> csrGraph::edgeList() const {
+	std::vector<weightedEdge> list;
+	list.reserve(edges());
+	for (int u = 0; u < n; u++) {
+		for (size_t i = offsets[u]; i < offsets[u + 1]; i++) {
+			if (u < targets[i]) {
+				weightedEdge e;
+				e.u = u;
+				e.v = targets[i];
+				e.w = weights[i];
+				list.push_back(e);
+			}
+		}
+	}
+	return list;
+}
+
+lazyFiberMetric::lazyFiberMetric(const csrGraph &g, const fiberSet &fibers,
+		size_t maxEntries) :
+		computed(0), g(g), fibers(fibers), maxEntries(maxEntries) {
+}
+
+double lazyFiberMetric::operator()(int u, int v) {
+	double w;
+	if (g.weight(u, v, w)) {
+		return w;
+	}
+	uint64_t key = (static_cast<uint64_t>(std::min(u, v)) << 32)
+			| static_cast<uint32_t>(std::max(u, v));
+	std::unordered_map<uint64_t, double>::iterator it = cache.find(key);
+	if (it != cache.end()) {
+		return it->second;
+	}
+	if (cache.size() >= maxEntries) {
+		cache.clear();
+	}
+	w = fibers.distance(u, v);
+	cache[key] = w;
+	computed++;
+	return w;
+}
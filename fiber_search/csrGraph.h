@@ -0,0 +1,69 @@
+/*
+ * csrGraph.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef CSRGRAPH_H_
+#define CSRGRAPH_H_
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "fiberSet.h"
+
+struct weightedEdge {
+	int u, v;
+	double w;
+};
+
+struct csrGraph {
+	/*
+	 * Undirected weighted graph in compressed sparse row form: the
+	 * neighbours of vertex u are targets[offsets[u] .. offsets[u + 1]),
+	 * sorted, with their weights alongside. Every edge is stored from both
+	 * ends, 12 bytes each, and a row is one contiguous run of memory.
+	 */
+	int n;
+	std::vector<size_t> offsets;
+	std::vector<int> targets;
+	std::vector<double> weights;
+
+	csrGraph() :
+			n(0) {
+	}
+	// from an edge list, each undirected edge once; repeated edges are
+	// kept once
+	csrGraph(int n, const std::vector<weightedEdge> &edges);
+
+	size_t edges() const {
+		return targets.size() / 2;
+	}
+	// weight of the edge (u, v), false if the graph does not have it
+	bool weight(int u, int v, double &w) const;
+	// every edge once (u < v)
+	std::vector<weightedEdge> edgeList() const;
+};
+
+class lazyFiberMetric {
+	/*
+	 * Fiber distance for any pair: from the graph if it has the edge,
+	 * otherwise computed and remembered in a cache of at most maxEntries
+	 * pairs (cleared when full, so memory stays bounded).
+	 */
+public:
+	lazyFiberMetric(const csrGraph &g, const fiberSet &fibers,
+			size_t maxEntries = 1 << 20);
+	double operator()(int u, int v);
+
+	long computed; // distances not found in the graph or the cache
+
+private:
+	const csrGraph &g;
+	const fiberSet &fibers;
+	size_t maxEntries;
+	std::unordered_map<uint64_t, double> cache;
+};
+
+#endif /* CSRGRAPH_H_ */
@@ -0,0 +1,444 @@
+/*
+ * fiberFile.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "fiberFile.h"
+
+using namespace std;
+
+struct fiberFileHeader {
+	char magic[4]; // "IMSF"
+	uint32_t version;
+	uint64_t fibers;
+	uint64_t states;
+	uint64_t orientations;
+};
+
+static const uint32_t FIBER_FILE_VERSION = 1;
+// text chunks per thread, so that uneven lines still balance
+static const int CHUNKS_PER_THREAD = 4;
+
+static size_t padded(size_t bytes) {
+	return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+// size of the file for the given counts, the arrays in the header's order
+static size_t fileBytes(uint64_t fibers, uint64_t states,
+		uint64_t orientations) {
+	return sizeof(fiberFileHeader) + (fibers + 1) * sizeof(uint64_t)
+			+ 3 * fibers * sizeof(double) + padded(states * sizeof(uint32_t))
+			+ 4 * orientations * sizeof(double);
+}
+
+fiberFile::fiberFile() :
+		fibers(0), states(0), orientations(0), offsets(NULL), x(NULL), y(
+		NULL), z(NULL), orientation(NULL), qx(NULL), qy(NULL), qz(NULL), qw(
+		NULL), data(NULL), bytes(0) {
+}
+
+fiberFile::~fiberFile() {
+	close();
+}
+
+void fiberFile::close() {
+	if (data) {
+		munmap(data, bytes);
+	}
+	data = NULL;
+	bytes = 0;
+	fibers = states = orientations = 0;
+	offsets = NULL;
+	x = y = z = qx = qy = qz = qw = NULL;
+	orientation = NULL;
+}
+
+bool fiberFile::open(const std::string &path) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	bool ok = (fstat(fd, &st) == 0)
+			&& (static_cast<size_t>(st.st_size) >= sizeof(fiberFileHeader));
+	void *map = MAP_FAILED;
+	if (ok) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		ok = (map != MAP_FAILED);
+	}
+	::close(fd);
+	if (!ok) {
+		return false;
+	}
+	const fiberFileHeader *h = static_cast<const fiberFileHeader *>(map);
+	if (memcmp(h->magic, "IMSF", 4) != 0 || h->version != FIBER_FILE_VERSION
+			|| fileBytes(h->fibers, h->states, h->orientations)
+					!= static_cast<uint64_t>(st.st_size)) {
+		munmap(map, st.st_size);
+		return false;
+	}
+	data = map;
+	bytes = st.st_size;
+	fibers = h->fibers;
+	states = h->states;
+	orientations = h->orientations;
+
+	const char *p = static_cast<const char *>(map) + sizeof(fiberFileHeader);
+	offsets = reinterpret_cast<const uint64_t *>(p);
+	p += (fibers + 1) * sizeof(uint64_t);
+	x = reinterpret_cast<const double *>(p);
+	y = x + fibers;
+	z = y + fibers;
+	p += 3 * fibers * sizeof(double);
+	orientation = reinterpret_cast<const uint32_t *>(p);
+	p += padded(states * sizeof(uint32_t));
+	qx = reinterpret_cast<const double *>(p);
+	qy = qx + orientations;
+	qz = qy + orientations;
+	qw = qz + orientations;
+
+	// the offsets and indices are trusted from here on
+	ok = offsets[0] == 0 && offsets[fibers] == states;
+	for (uint64_t f = 0; ok && f < fibers; f++) {
+		ok = offsets[f] <= offsets[f + 1];
+	}
+	for (uint64_t s = 0; ok && s < states; s++) {
+		ok = orientation[s] < orientations;
+	}
+	if (!ok) {
+		close();
+	}
+	return ok;
+}
+
+static bool writeArray(std::ofstream &out, const void *p, size_t bytes) {
+	out.write(static_cast<const char *>(p), bytes);
+	return out.good();
+}
+
+bool writeFiberFile(const std::string &path, const fiberTable &table) {
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if (!out) {
+		return false;
+	}
+	fiberFileHeader h;
+	memcpy(h.magic, "IMSF", 4);
+	h.version = FIBER_FILE_VERSION;
+	h.fibers = table.fibers();
+	h.states = table.orientation.size();
+	h.orientations = table.qx.size();
+	size_t n = h.fibers, o = h.orientations;
+	static const char zeros[8] = { 0 };
+	return writeArray(out, &h, sizeof(h))
+			&& writeArray(out, table.offsets.data(), (n + 1) * sizeof(uint64_t))
+			&& writeArray(out, table.x.data(), n * sizeof(double))
+			&& writeArray(out, table.y.data(), n * sizeof(double))
+			&& writeArray(out, table.z.data(), n * sizeof(double))
+			&& writeArray(out, table.orientation.data(),
+					h.states * sizeof(uint32_t))
+			&& writeArray(out, zeros,
+					padded(h.states * sizeof(uint32_t))
+							- h.states * sizeof(uint32_t))
+			&& writeArray(out, table.qx.data(), o * sizeof(double))
+			&& writeArray(out, table.qy.data(), o * sizeof(double))
+			&& writeArray(out, table.qz.data(), o * sizeof(double))
+			&& writeArray(out, table.qw.data(), o * sizeof(double));
+}
+
+// powers of ten that are exact doubles
+static const double EXACT_POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+		1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+		1e20, 1e21, 1e22 };
+
+static bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool parseNumber(const char *&p, const char *end, double &v) {
+	// the next number before end of line, false if there is none. Decimal
+	// numbers of up to 15 digits with a small exponent are an exact integer
+	// times an exact power of ten, so one multiplication or division rounds
+	// them correctly; anything else goes to strtod.
+	while (p < end && isBlank(*p)) {
+		p++;
+	}
+	if (p == end || *p == '\n') {
+		return false;
+	}
+	const char *start = p;
+	bool negative = (*p == '-');
+	if (*p == '-' || *p == '+') {
+		p++;
+	}
+	uint64_t mantissa = 0;
+	int digits = 0, scale = 0;
+	bool any = false;
+	for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+		if (digits < 19) {
+			mantissa = 10 * mantissa + (*p - '0');
+			digits += (mantissa != 0);
+		} else {
+			scale++;
+			digits++;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+			if (digits < 19) {
+				mantissa = 10 * mantissa + (*p - '0');
+				digits += (mantissa != 0);
+				scale--;
+			} else {
+				digits++;
+			}
+		}
+	}
+	if (any && p < end && (*p == 'e' || *p == 'E')) {
+		const char *q = p + 1;
+		bool down = (q < end && *q == '-');
+		if (q < end && (*q == '-' || *q == '+')) {
+			q++;
+		}
+		if (q < end && *q >= '0' && *q <= '9') {
+			int e = 0;
+			for (; q < end && *q >= '0' && *q <= '9'; q++) {
+				e = std::min(10 * e + (*q - '0'), 100000);
+			}
+			scale += down ? -e : e;
+			p = q;
+		}
+	}
+	bool token = any && (p == end || isBlank(*p) || *p == '\n');
+	if (token && digits <= 15 && scale >= -22 && scale <= 22) {
+		v = static_cast<double>(mantissa);
+		v = (scale < 0) ? v / EXACT_POWERS[-scale] : v * EXACT_POWERS[scale];
+		v = negative ? -v : v;
+		return true;
+	}
+	// not a plain decimal (or too long for the fast path); strtod needs a
+	// terminated copy of the token
+	p = start;
+	while (p < end && !isBlank(*p) && *p != '\n') {
+		p++;
+	}
+	std::string text(start, p);
+	char *stop;
+	v = strtod(text.c_str(), &stop);
+	if (stop == text.c_str()) {
+		v = 0.0;
+	}
+	return true;
+}
+
+// a chunk of the text file parsed on its own, orientations numbered locally
+struct parsedChunk {
+	std::vector<uint64_t> counts;
+	std::vector<double> x, y, z;
+	std::vector<uint32_t> orientation;
+	std::vector<double> q; // 4 per local orientation
+};
+
+// an orientation as the bits of its four components
+struct quaternionKey {
+	uint64_t bits[4];
+
+	explicit quaternionKey(const double *q) {
+		memcpy(bits, q, sizeof(bits));
+	}
+	bool operator==(const quaternionKey &other) const {
+		return memcmp(bits, other.bits, sizeof(bits)) == 0;
+	}
+};
+
+struct quaternionKeyHash {
+	size_t operator()(const quaternionKey &k) const {
+		uint64_t h = 1469598103934665603ULL;
+		for (int i = 0; i < 4; i++) {
+			h = (h ^ k.bits[i]) * 1099511628211ULL;
+			h ^= h >> 29;
+		}
+		return static_cast<size_t>(h);
+	}
+};
+
+typedef std::unordered_map<quaternionKey, uint32_t, quaternionKeyHash> \
+		quaternionIds;
+
+static uint32_t internQuaternion(const double *q, quaternionIds &ids,
+		std::vector<double> &table) {
+	std::pair<quaternionIds::iterator, bool> found = ids.insert(
+			std::make_pair(quaternionKey(q), static_cast<uint32_t>(ids.size())));
+	if (found.second) {
+		table.insert(table.end(), q, q + 4);
+	}
+	return found.first->second;
+}
+
+static void parseChunk(const char *p, const char *end, parsedChunk &chunk) {
+	quaternionIds ids;
+	std::vector<double> values;
+	while (p < end) {
+		const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+		if (!eol) {
+			eol = end;
+		}
+		values.clear();
+		double v;
+		while (parseNumber(p, eol, v)) {
+			values.push_back(v);
+		}
+		p = eol + 1;
+		if (values.empty()) {
+			// blank line
+			continue;
+		}
+		// a partial position reads as zeros, a partial orientation is dropped
+		values.resize(std::max(values.size(), static_cast<size_t>(3)), 0.0);
+		chunk.x.push_back(values[0]);
+		chunk.y.push_back(values[1]);
+		chunk.z.push_back(values[2]);
+		size_t count = (values.size() - 3) / 4;
+		chunk.counts.push_back(count);
+		for (size_t i = 0; i < count; i++) {
+			// unit quaternions, normalised by Eigen as the states always were
+			double *q = &values[3 + 4 * i];
+			Eigen::Map<Eigen::Vector4d> v(q);
+			v.normalize();
+			chunk.orientation.push_back(internQuaternion(q, ids, chunk.q));
+		}
+	}
+}
+
+bool readFiberText(const std::string &path, fiberTable &table) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+	size_t size = st.st_size;
+	void *map = MAP_FAILED;
+	if (size > 0) {
+		map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	::close(fd);
+	if (size > 0 && map == MAP_FAILED) {
+		return false;
+	}
+	const char *text = (size > 0) ? static_cast<const char *>(map) : "";
+
+	// chunks of about equal size, each starting at the beginning of a line
+	int chunks = (size > 0) ? CHUNKS_PER_THREAD * omp_get_max_threads() : 0;
+	std::vector<size_t> bounds(1, 0);
+	for (int c = 1; c < chunks; c++) {
+		size_t b = std::max(bounds.back(), size * c / chunks);
+		const void *eol = (b < size) ? memchr(text + b, '\n', size - b) : NULL;
+		b = eol ? static_cast<const char *>(eol) - text + 1 : size;
+		bounds.push_back(b);
+	}
+	bounds.push_back(size);
+	chunks = static_cast<int>(bounds.size()) - 1;
+	std::vector<parsedChunk> parsed(chunks);
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int c = 0; c < chunks; c++) {
+		parseChunk(text + bounds[c], text + bounds[c + 1], parsed[c]);
+	}
+	if (size > 0) {
+		munmap(map, size);
+	}
+
+	// concatenate in file order, one table of distinct orientations
+	table = fiberTable();
+	table.offsets.push_back(0);
+	quaternionIds ids;
+	std::vector<double> q;
+	for (int c = 0; c < chunks; c++) {
+		parsedChunk &chunk = parsed[c];
+		std::vector<uint32_t> global(chunk.q.size() / 4);
+		for (size_t i = 0; i < global.size(); i++) {
+			global[i] = internQuaternion(&chunk.q[4 * i], ids, q);
+		}
+		for (size_t f = 0; f < chunk.counts.size(); f++) {
+			table.offsets.push_back(table.offsets.back() + chunk.counts[f]);
+		}
+		table.x.insert(table.x.end(), chunk.x.begin(), chunk.x.end());
+		table.y.insert(table.y.end(), chunk.y.begin(), chunk.y.end());
+		table.z.insert(table.z.end(), chunk.z.begin(), chunk.z.end());
+		for (size_t s = 0; s < chunk.orientation.size(); s++) {
+			table.orientation.push_back(global[chunk.orientation[s]]);
+		}
+		parsedChunk().q.swap(chunk.q);
+	}
+	size_t o = q.size() / 4;
+	table.qx.resize(o);
+	table.qy.resize(o);
+	table.qz.resize(o);
+	table.qw.resize(o);
+	for (size_t i = 0; i < o; i++) {
+		table.qx[i] = q[4 * i];
+		table.qy[i] = q[4 * i + 1];
+		table.qz[i] = q[4 * i + 2];
+		table.qw[i] = q[4 * i + 3];
+	}
+	return true;
+}
+
+static std::vector<fiber> tableFibers(size_t n, const uint64_t *offsets,
+		const double *x, const double *y, const double *z,
+		const uint32_t *orientation, const double *qx, const double *qy,
+		const double *qz, const double *qw) {
+	std::vector<fiber> fibers(n);
+	int count = static_cast<int>(n);
+#pragma omp parallel for schedule(static, 1024)
+	for (int f = 0; f < count; f++) {
+		fiber &states = fibers[f];
+		states.resize(offsets[f + 1] - offsets[f]);
+		for (size_t i = 0; i < states.size(); i++) {
+			uint32_t o = orientation[offsets[f] + i];
+			state &s = states[i];
+			s.x = x[f];
+			s.y = y[f];
+			s.z = z[f];
+			s.qx = qx[o];
+			s.qy = qy[o];
+			s.qz = qz[o];
+			s.qw = qw[o];
+		}
+	}
+	return fibers;
+}
+
+std::vector<fiber> readFibers(const std::string &path) {
+	fiberFile binary;
+	if (binary.open(path)) {
+		return tableFibers(binary.fibers, binary.offsets, binary.x, binary.y,
+				binary.z, binary.orientation, binary.qx, binary.qy, binary.qz,
+				binary.qw);
+	}
+	fiberTable table;
+	if (!readFiberText(path, table)) {
+		cout << "Cannot read fibers from " << path << endl;
+		exit(1);
+	}
+	return tableFibers(table.fibers(), table.offsets.data(), table.x.data(),
+			table.y.data(), table.z.data(), table.orientation.data(),
+			table.qx.data(), table.qy.data(), table.qz.data(), table.qw.data());
+}
@@ -0,0 +1,77 @@
+/*
+ * fiberFile.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef FIBERFILE_H_
+#define FIBERFILE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "state.h"
+
+/*
+ * Fibers as flat arrays. The states of fiber f are offsets[f] ..
+ * offsets[f + 1], all at the position (x[f], y[f], z[f]); state s has the
+ * unit quaternion orientation[s] of the table qx, qy, qz, qw, in which
+ * every distinct orientation appears once.
+ *
+ * The binary fiber file is this table as it is in memory:
+ *   "IMSF", uint32 version, uint64 fibers, states, orientations
+ *   uint64 offsets[fibers + 1]
+ *   double x[fibers], y[fibers], z[fibers]
+ *   uint32 orientation[states], padded to 8 bytes
+ *   double qx[orientations], qy[..], qz[..], qw[..]
+ * so it is mapped and used without parsing.
+ */
+struct fiberTable {
+	std::vector<uint64_t> offsets;
+	std::vector<double> x, y, z;
+	std::vector<uint32_t> orientation;
+	std::vector<double> qx, qy, qz, qw;
+
+	size_t fibers() const {
+		return x.size();
+	}
+};
+
+class fiberFile {
+	/*
+	 * Read only view of a binary fiber file through mmap.
+	 */
+public:
+	fiberFile();
+	~fiberFile();
+	// false if the file cannot be mapped or is not a fiber file
+	bool open(const std::string &path);
+	void close();
+
+	uint64_t fibers, states, orientations;
+	const uint64_t *offsets;
+	const double *x, *y, *z;
+	const uint32_t *orientation;
+	const double *qx, *qy, *qz, *qw;
+
+private:
+	fiberFile(const fiberFile &);
+	fiberFile &operator=(const fiberFile &);
+	void *data;
+	size_t bytes;
+};
+
+// parse the text format, one fiber per line: the position and then four
+// numbers (qx qy qz qw) per orientation, normalised on the way; the file
+// is split at line ends and parsed by all threads. False if it cannot be
+// read.
+bool readFiberText(const std::string &path, fiberTable &table);
+// write the binary format, false if it cannot be written
+bool writeFiberFile(const std::string &path, const fiberTable &table);
+
+// fibers of a binary or text fiber file (told apart by the header), exits
+// if the file cannot be read
+std::vector<fiber> readFibers(const std::string &path);
+
+#endif /* FIBERFILE_H_ */
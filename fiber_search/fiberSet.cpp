@@ -0,0 +1,171 @@
+/*
+ * fiberSet.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <iostream>
+
+#include "fiberSet.h"
+
+// largest number of distinct quaternions whose pairs are tabulated, 2048
+// orientations take 80 MB; beyond it pairs are computed on demand
+static const size_t MAX_TABLE_ORIENTATIONS = 2048;
+
+static size_t tableIndex(size_t a, size_t b) {
+	// the pair (a, b), a <= b, in the packed upper triangle
+	return b * (b + 1) / 2 + a;
+}
+
+static rotationPair rotationBetween(const double *q1, const double *q2) {
+	// see rotationPair, q1 and q2 normalised (x, y, z, w)
+	double x1 = q1[0], y1 = q1[1], z1 = q1[2], w1 = q1[3];
+	double x2 = q2[0], y2 = q2[1], z2 = q2[2], w2 = q2[3];
+	// relative rotation in the world frame, q2 * conj(q1), whose axis is
+	// R1 times the axis of conj(q1) * q2
+	double rw = w2 * w1 + x2 * x1 + y2 * y1 + z2 * z1;
+	double rx = -w2 * x1 + x2 * w1 - y2 * z1 + z2 * y1;
+	double ry = -w2 * y1 + y2 * w1 - z2 * x1 + x2 * z1;
+	double rz = -w2 * z1 + z2 * w1 - x2 * y1 + y2 * x1;
+	double s = std::sqrt(rx * rx + ry * ry + rz * rz);
+	double h = std::atan2(s, std::fabs(rw));
+
+	rotationPair p;
+	p.rot = 8 * h * h;
+	if (s < 1e-8) {
+		p.g = 1;
+		p.w[0] = p.w[1] = p.w[2] = 0;
+		return p;
+	}
+	double f = h / s;
+	p.g = f * f;
+	double scale = std::sqrt(std::max(0.0, p.g - 1)) / s;
+	p.w[0] = rx * scale;
+	p.w[1] = ry * scale;
+	p.w[2] = rz * scale;
+	return p;
+}
+
+fiberSet::fiberSet(const std::vector<fiber> &fibers, bool verbose) :
+		fibers(fibers), nq(0) {
+	std::map<std::vector<double>, int> quaternionIds;
+	std::map<std::vector<int>, int> setIds;
+	size_t n = fibers.size();
+	arrays.resize(n);
+	shared.assign(n, true);
+	position.assign(3 * n, 0);
+	setOf.assign(n, -1);
+
+	for (size_t f = 0; f < n; f++) {
+		const fiber &fb = fibers[f];
+		arrays[f] = stateArray(fb);
+		std::vector<int> ids;
+		for (size_t k = 0; k < fb.size(); k++) {
+			if (fb[k].x != fb[0].x || fb[k].y != fb[0].y || fb[k].z != fb[0].z) {
+				shared[f] = false;
+			}
+			const stateArray &a = arrays[f];
+			std::vector<double> q(4);
+			q[0] = a.qx[k];
+			q[1] = a.qy[k];
+			q[2] = a.qz[k];
+			q[3] = a.qw[k];
+			auto found = quaternionIds.find(q);
+			if (found == quaternionIds.end()) {
+				found = quaternionIds.insert(
+						std::make_pair(q, static_cast<int>(nq++))).first;
+				quaternions.insert(quaternions.end(), q.begin(), q.end());
+			}
+			ids.push_back(found->second);
+		}
+		if (!fb.empty()) {
+			position[3 * f] = fb[0].x;
+			position[3 * f + 1] = fb[0].y;
+			position[3 * f + 2] = fb[0].z;
+		}
+		auto found = setIds.find(ids);
+		if (found == setIds.end()) {
+			found = setIds.insert(
+					std::make_pair(ids, static_cast<int>(sets.size()))).first;
+			sets.push_back(ids);
+		}
+		setOf[f] = found->second;
+	}
+
+	if (nq <= MAX_TABLE_ORIENTATIONS) {
+		// swapping a and b only negates w, so the upper triangle is enough
+		table.resize(tableIndex(0, nq));
+#pragma omp parallel for schedule(dynamic, 16)
+		for (long b = 0; b < static_cast<long>(nq); b++) {
+			for (long a = 0; a <= b; a++) {
+				table[tableIndex(a, b)] = rotationBetween(&quaternions[4 * a],
+						&quaternions[4 * b]);
+			}
+		}
+	}
+	if (verbose) {
+		std::cout << n << " fibers, " << sets.size()
+				<< " distinct orientation sets, " << nq
+				<< " distinct orientations";
+		if (table.empty()) {
+			std::cout << ", rotations computed on demand" << std::endl;
+		} else {
+			std::cout << ", rotation table of "
+					<< table.size() * sizeof(rotationPair) / 1024 << " KB"
+					<< std::endl;
+		}
+	}
+}
+
+rotationPair fiberSet::rotation(int a, int b) const {
+	if (!table.empty()) {
+		if (a <= b) {
+			return table[tableIndex(a, b)];
+		}
+		rotationPair p = table[tableIndex(b, a)];
+		p.w[0] = -p.w[0];
+		p.w[1] = -p.w[1];
+		p.w[2] = -p.w[2];
+		return p;
+	}
+	return rotationBetween(&quaternions[4 * a], &quaternions[4 * b]);
+}
+
+double fiberSet::distance(int i, int j) const {
+	int si, sj;
+	return distance(i, j, si, sj);
+}
+
+double fiberSet::distance(int i, int j, int &si, int &sj) const {
+	si = sj = -1;
+	if (fibers[i].empty() || fibers[j].empty()) {
+		return 1e10;
+	}
+	if (!shared[i] || !shared[j]) {
+		return se3MinDistance(arrays[i], arrays[j], si, sj);
+	}
+	double dx = position[3 * j] - position[3 * i];
+	double dy = position[3 * j + 1] - position[3 * i + 1];
+	double dz = position[3 * j + 2] - position[3 * i + 2];
+	double dd = dx * dx + dy * dy + dz * dz;
+	const std::vector<int> &a = sets[setOf[i]];
+	const std::vector<int> &b = sets[setOf[j]];
+	double best = std::numeric_limits<double>::infinity();
+	for (size_t k = 0; k < a.size(); k++) {
+		for (size_t l = 0; l < b.size(); l++) {
+			rotationPair p = rotation(a[k], b[l]);
+			double wd = p.w[0] * dx + p.w[1] * dy + p.w[2] * dz;
+			double d2 = p.rot + p.g * dd - wd * wd;
+			if (d2 < best) {
+				best = d2;
+				si = static_cast<int>(k);
+				sj = static_cast<int>(l);
+			}
+		}
+	}
+	return std::sqrt(std::max(0.0, best));
+}
@@ -0,0 +1,91 @@
+/*
+ * fiberSet.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef FIBERSET_H_
+#define FIBERSET_H_
+
+#include <vector>
+
+#include "state.h"
+#include "se3kernel.h"
+
+struct rotationPair {
+	/*
+	 * Everything the distance between two states needs from their
+	 * orientations. With D the offset between their positions (world frame)
+	 *   d^2 = rot + g |D|^2 - (w.D)^2
+	 * where rot = 2 theta^2, g = (theta/2)^2 / sin^2(theta/2) and w is the
+	 * world axis of the relative rotation scaled by sqrt(g - 1).
+	 */
+	double rot, g;
+	double w[3];
+};
+
+class fiberSet {
+	/*
+	 * Fibers with their orientations interned. The states of a fiber usually
+	 * share one position and only differ in orientation, and a handful of
+	 * orientation sets repeat over the whole input. Every distinct
+	 * quaternion gets an id, every distinct ordered list of them (a fiber's
+	 * orientation set) gets an id, and the rotation part of the distance is
+	 * tabulated once over the distinct quaternions. A fiber to fiber
+	 * distance is then a table lookup and a few products per state pair.
+	 * Fibers whose states do not share a position fall back to the SoA
+	 * kernel.
+	 */
+public:
+	// verbose reports the number of distinct orientations
+	explicit fiberSet(const std::vector<fiber> &fibers, bool verbose = true);
+
+	size_t size() const {
+		return fibers.size();
+	}
+	const fiber &states(int f) const {
+		return fibers[f];
+	}
+	// interned orientation set of a fiber
+	int orientationSet(int f) const {
+		return setOf[f];
+	}
+	// position shared by the states of a fiber (that of its first state
+	// if they differ)
+	const double *positionOf(int f) const {
+		return &position[3 * f];
+	}
+	const std::vector<double> &positions() const {
+		return position;
+	}
+	bool sharesPosition(int f) const {
+		return shared[f];
+	}
+	size_t distinctOrientations() const {
+		return nq;
+	}
+	size_t distinctSets() const {
+		return sets.size();
+	}
+
+	// shortest distance between the states of two fibers, fiberDistance
+	double distance(int i, int j) const;
+	// the same and the indices of the closest states in each fiber
+	double distance(int i, int j, int &si, int &sj) const;
+
+	// rotation part for two interned quaternions
+	rotationPair rotation(int a, int b) const;
+
+private:
+	std::vector<fiber> fibers;
+	std::vector<stateArray> arrays; // fallback for fibers without a position
+	std::vector<bool> shared;       // states share one position
+	std::vector<double> position;   // 3 per fiber
+	std::vector<int> setOf;
+	std::vector<std::vector<int> > sets; // quaternion ids, in state order
+	std::vector<double> quaternions;     // 4 per distinct quaternion
+	size_t nq;
+	std::vector<rotationPair> table;     // a <= b pairs, empty if too large
+};
+
+#endif /* FIBERSET_H_ */
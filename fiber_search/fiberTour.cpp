@@ -0,0 +1,531 @@
+/*
+ * fiberTour.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "fiberTour.h"
+
+using namespace std;
+
+// position candidates per neighbour, as in knnFiberGraph
+static const int CANDIDATE_FACTOR = 4;
+// fibers per grid cell on average for the initial set
+static const double FIBERS_PER_CELL = 2.0;
+// cell coordinates are packed 21 bits each
+static const int CELL_BITS = 21;
+
+fiberTour::fiberTour(const std::vector<fiber> &fibers,
+		const std::vector<unsigned int> &tour, int k) :
+		k(k), count(0), cell(1.0), head(-1), len(0.0) {
+	for (int a = 0; a < 3; a++) {
+		lo[a] = 0;
+		hi[a] = -1;
+	}
+	// grid spacing from the density of the initial set
+	double mn[3] = { 0, 0, 0 }, mx[3] = { 0, 0, 0 };
+	bool first = true;
+	for (size_t f = 0; f < fibers.size(); f++) {
+		if (fibers[f].empty()) {
+			continue;
+		}
+		const state &s = fibers[f][0];
+		double p[3] = { s.x, s.y, s.z };
+		for (int a = 0; a < 3; a++) {
+			mn[a] = first ? p[a] : std::min(mn[a], p[a]);
+			mx[a] = first ? p[a] : std::max(mx[a], p[a]);
+		}
+		first = false;
+	}
+	double volume = 1.0;
+	int axes = 0;
+	for (int a = 0; a < 3; a++) {
+		if (mx[a] > mn[a]) {
+			volume *= mx[a] - mn[a];
+			axes++;
+		}
+	}
+	if (axes > 0 && fibers.size() > 1) {
+		cell = std::pow(volume * FIBERS_PER_CELL / fibers.size(), 1.0 / axes);
+	}
+
+	for (size_t f = 0; f < fibers.size(); f++) {
+		addFiber(fibers[f]);
+		if (fibers[f].empty()) {
+			live[f] = false;
+			count--;
+		} else {
+			addToGrid(static_cast<int>(f));
+		}
+	}
+	int n = static_cast<int>(all.size());
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int f = 0; f < n; f++) {
+		if (live[f]) {
+			fillNeighbours(f);
+		}
+	}
+	for (int f = 0; f < n; f++) {
+		for (size_t i = 0; i < near[f].size(); i++) {
+			listedBy[near[f][i].second].push_back(f);
+		}
+		if (live[f]) {
+			reaches.insert(reach[f]);
+		}
+	}
+
+	// the cycle, ignoring the closing repeat of the first fiber
+	std::vector<int> order;
+	std::vector<bool> seen(n, false);
+	for (size_t i = 0; i < tour.size(); i++) {
+		int f = static_cast<int>(tour[i]);
+		if (f < n && live[f] && !seen[f]) {
+			seen[f] = true;
+			order.push_back(f);
+		}
+	}
+	if (order.size() != count) {
+		std::ostringstream message;
+		message << "tour covers " << order.size() << " of " << count
+				<< " fibers";
+		throw std::invalid_argument(message.str());
+	}
+	for (size_t i = 0; i < order.size(); i++) {
+		int a = order[i], b = order[(i + 1) % order.size()];
+		next[a] = b;
+		prev[b] = a;
+		len += distance(a, b);
+	}
+	head = order.empty() ? -1 : order[0];
+}
+
+double fiberTour::distance(int a, int b) const {
+	int ia, ib;
+	return se3MinDistance(arrays[a], arrays[b], ia, ib);
+}
+
+int64_t fiberTour::cellKey(const double *p) const {
+	int64_t key = 0;
+	for (int a = 0; a < 3; a++) {
+		int64_t c = static_cast<int64_t>(std::floor(p[a] / cell));
+		key = (key << CELL_BITS) | (c & ((int64_t(1) << CELL_BITS) - 1));
+	}
+	return key;
+}
+
+void fiberTour::addToGrid(int id) {
+	const double *p = positionOf(id);
+	grid[cellKey(p)].push_back(id);
+	for (int a = 0; a < 3; a++) {
+		int c = static_cast<int>(std::floor(p[a] / cell));
+		if (lo[a] > hi[a]) {
+			lo[a] = hi[a] = c;
+		} else {
+			lo[a] = std::min(lo[a], c);
+			hi[a] = std::max(hi[a], c);
+		}
+	}
+}
+
+void fiberTour::removeFromGrid(int id) {
+	std::unordered_map<int64_t, std::vector<int> >::iterator it = grid.find(
+			cellKey(positionOf(id)));
+	std::vector<int> &members = it->second;
+	members.erase(std::find(members.begin(), members.end(), id));
+	if (members.empty()) {
+		grid.erase(it);
+	}
+}
+
+std::vector<int> fiberTour::nearestByPosition(const double *p, size_t m,
+		int exclude) const {
+	// rings of cells around the cell of p, clipped to the occupied cells,
+	// until m fibers are found and no cell of the next ring can hold a
+	// closer one. Rings that miss the occupied cells are skipped, and once
+	// the rings would have visited more cells than are occupied every
+	// fiber is scanned instead, so a query far from the set costs no more
+	// than a scan.
+	if (grid.empty() || m == 0) {
+		return std::vector<int>();
+	}
+	int c[3];
+	int first = 0, reach = 0;
+	for (int a = 0; a < 3; a++) {
+		c[a] = static_cast<int>(std::floor(p[a] / cell));
+		first = std::max(first, std::max(lo[a] - c[a], c[a] - hi[a]));
+		reach = std::max(reach, std::max(c[a] - lo[a], hi[a] - c[a]));
+	}
+	std::vector<std::pair<double, int> > found;
+	std::function<void(const std::vector<int> &)> take =
+			[&](const std::vector<int> &members) {
+				for (size_t e = 0; e < members.size(); e++) {
+					int f = members[e];
+					if (f == exclude) {
+						continue;
+					}
+					const double *x = positionOf(f);
+					double d2 = 0;
+					for (int a = 0; a < 3; a++) {
+						d2 += (x[a] - p[a]) * (x[a] - p[a]);
+					}
+					found.push_back(std::make_pair(d2, f));
+				}
+			};
+	size_t visited = 0;
+	for (int r = first; r <= reach; r++) {
+		// the ring clipped to the occupied cells: the cells of the clipped
+		// cube [-r, r]^3 that are not in the clipped cube [-(r-1), r-1]^3
+		int from[3], to[3];
+		size_t cube = 1, inner = (r > 0) ? 1 : 0;
+		for (int a = 0; a < 3; a++) {
+			from[a] = std::max(-r, lo[a] - c[a]);
+			to[a] = std::min(r, hi[a] - c[a]);
+			cube *= std::max(0, to[a] - from[a] + 1);
+			inner *= std::max(0, std::min(r - 1, hi[a] - c[a])
+					- std::max(1 - r, lo[a] - c[a]) + 1);
+		}
+		visited += cube - inner;
+		if (visited > grid.size()) {
+			found.clear();
+			for (std::unordered_map<int64_t, std::vector<int> >::const_iterator it =
+					grid.begin(); it != grid.end(); ++it) {
+				take(it->second);
+			}
+			break;
+		}
+		for (int i = from[0]; i <= to[0]; i++) {
+			for (int j = from[1]; j <= to[1]; j++) {
+				// inside the ring's faces in i and j only the two cells
+				// l = -r and l = r belong to the ring
+				bool face = (std::abs(i) == r) || (std::abs(j) == r);
+				int step = face ? 1 : std::max(1, 2 * r);
+				for (int l = face ? from[2] : -r; l <= to[2]; l += step) {
+					if (l < from[2]) {
+						continue;
+					}
+					double q[3] = { (c[0] + i + 0.5) * cell, (c[1] + j + 0.5)
+							* cell, (c[2] + l + 0.5) * cell };
+					std::unordered_map<int64_t, std::vector<int> >::const_iterator it =
+							grid.find(cellKey(q));
+					if (it != grid.end()) {
+						take(it->second);
+					}
+				}
+			}
+		}
+		// everything within r cells of p's cell is seen, so every point
+		// closer than r * cell
+		if (found.size() >= m) {
+			std::nth_element(found.begin(), found.begin() + (m - 1),
+					found.end());
+			if (found[m - 1].first <= (r * cell) * (r * cell)) {
+				break;
+			}
+		}
+	}
+	size_t keep = std::min(m, found.size());
+	std::partial_sort(found.begin(), found.begin() + keep, found.end());
+	std::vector<int> result(keep);
+	for (size_t i = 0; i < keep; i++) {
+		result[i] = found[i].second;
+	}
+	return result;
+}
+
+std::vector<int> fiberTour::reachingPosition(const double *p,
+		int exclude) const {
+	// the box of cells within the largest reach of p, clipped to the
+	// occupied cells, or every fiber if it has more cells than are occupied
+	std::vector<int> result;
+	if (reaches.empty()) {
+		return result;
+	}
+	double r = std::sqrt(*reaches.rbegin());
+	int from[3], to[3];
+	size_t cells = 1;
+	bool scan = !(r < std::numeric_limits<double>::infinity());
+	for (int a = 0; a < 3 && !scan; a++) {
+		from[a] = std::max(lo[a],
+				static_cast<int>(std::floor((p[a] - r) / cell)));
+		to[a] = std::min(hi[a],
+				static_cast<int>(std::floor((p[a] + r) / cell)));
+		if (to[a] < from[a]) {
+			return result;
+		}
+		cells *= to[a] - from[a] + 1;
+		scan = cells > grid.size();
+	}
+	std::function<void(const std::vector<int> &)> take =
+			[&](const std::vector<int> &members) {
+				for (size_t e = 0; e < members.size(); e++) {
+					int f = members[e];
+					const double *x = positionOf(f);
+					double d2 = 0;
+					for (int a = 0; a < 3; a++) {
+						d2 += (x[a] - p[a]) * (x[a] - p[a]);
+					}
+					if (f != exclude && d2 <= reach[f]) {
+						result.push_back(f);
+					}
+				}
+			};
+	if (scan) {
+		for (std::unordered_map<int64_t, std::vector<int> >::const_iterator it =
+				grid.begin(); it != grid.end(); ++it) {
+			take(it->second);
+		}
+		return result;
+	}
+	for (int i = from[0]; i <= to[0]; i++) {
+		for (int j = from[1]; j <= to[1]; j++) {
+			for (int l = from[2]; l <= to[2]; l++) {
+				double q[3] = { (i + 0.5) * cell, (j + 0.5) * cell, (l + 0.5)
+						* cell };
+				std::unordered_map<int64_t, std::vector<int> >::const_iterator it =
+						grid.find(cellKey(q));
+				if (it != grid.end()) {
+					take(it->second);
+				}
+			}
+		}
+	}
+	return result;
+}
+
+int fiberTour::addFiber(const fiber &f) {
+	int id = static_cast<int>(all.size());
+	all.push_back(f);
+	arrays.push_back(stateArray(f));
+	for (int a = 0; a < 3; a++) {
+		position.push_back(0.0);
+	}
+	if (!f.empty()) {
+		position[3 * id] = f[0].x;
+		position[3 * id + 1] = f[0].y;
+		position[3 * id + 2] = f[0].z;
+	}
+	live.push_back(true);
+	near.push_back(neighbourList());
+	listedBy.push_back(std::vector<int>());
+	reach.push_back(std::numeric_limits<double>::infinity());
+	next.push_back(-1);
+	prev.push_back(-1);
+	count++;
+	return id;
+}
+
+void fiberTour::fillNeighbours(int id) {
+	std::vector<int> candidates = nearestByPosition(positionOf(id),
+			CANDIDATE_FACTOR * k, id);
+	neighbourList &list = near[id];
+	list.clear();
+	for (size_t c = 0; c < candidates.size(); c++) {
+		list.push_back(std::make_pair(distance(id, candidates[c]),
+				candidates[c]));
+	}
+	size_t keep = std::min(list.size(), static_cast<size_t>(k));
+	std::partial_sort(list.begin(), list.begin() + keep, list.end());
+	list.resize(keep);
+	reach[id] = std::numeric_limits<double>::infinity();
+	if (candidates.size() == static_cast<size_t>(CANDIDATE_FACTOR * k)) {
+		const double *p = positionOf(id), *x = positionOf(candidates.back());
+		double d2 = 0;
+		for (int a = 0; a < 3; a++) {
+			d2 += (x[a] - p[a]) * (x[a] - p[a]);
+		}
+		reach[id] = d2;
+	}
+}
+
+void fiberTour::refillNeighbours(int id) {
+	for (size_t j = 0; j < near[id].size(); j++) {
+		dropNeighbour(near[id][j].second, id);
+	}
+	reaches.erase(reaches.find(reach[id]));
+	fillNeighbours(id);
+	for (size_t j = 0; j < near[id].size(); j++) {
+		listedBy[near[id][j].second].push_back(id);
+	}
+	reaches.insert(reach[id]);
+}
+
+void fiberTour::dropNeighbour(int other, int id) {
+	// id no longer lists other
+	std::vector<int> &by = listedBy[other];
+	std::vector<int>::iterator it = std::find(by.begin(), by.end(), id);
+	if (it != by.end()) {
+		by.erase(it);
+	}
+}
+
+std::vector<int> fiberTour::neighbours(int id) const {
+	std::vector<int> ids;
+	for (size_t i = 0; i < near[id].size(); i++) {
+		ids.push_back(near[id][i].second);
+	}
+	return ids;
+}
+
+int fiberTour::insert(const fiber &f) {
+	if (f.empty()) {
+		return -1;
+	}
+	int id = addFiber(f);
+	addToGrid(id);
+
+	// the lists of the fibers whose candidates it enters, found before it
+	// is counted in the reaches, and its own
+	std::vector<int> reaching = reachingPosition(positionOf(id), id);
+	for (size_t i = 0; i < reaching.size(); i++) {
+		refillNeighbours(reaching[i]);
+	}
+	fillNeighbours(id);
+	for (size_t i = 0; i < near[id].size(); i++) {
+		listedBy[near[id][i].second].push_back(id);
+	}
+	reaches.insert(reach[id]);
+
+	// cheapest gap next to one of its neighbours
+	if (count == 1) {
+		next[id] = prev[id] = id;
+		head = id;
+		return id;
+	}
+	int bestA = -1;
+	double bestCost = 0;
+	for (size_t i = 0; i < near[id].size(); i++) {
+		int c = near[id][i].second;
+		int gaps[2][2] = { { c, next[c] }, { prev[c], c } };
+		for (int g = 0; g < 2; g++) {
+			int a = gaps[g][0], b = gaps[g][1];
+			double cost = distance(a, id) + distance(id, b)
+					- (a == b ? 0.0 : distance(a, b));
+			if (bestA < 0 || cost < bestCost) {
+				bestA = a;
+				bestCost = cost;
+			}
+		}
+	}
+	int b = next[bestA];
+	next[bestA] = id;
+	prev[id] = bestA;
+	next[id] = b;
+	prev[b] = id;
+	len += bestCost;
+	return id;
+}
+
+bool fiberTour::remove(int id) {
+	if (!contains(id)) {
+		return false;
+	}
+	// out of the cycle
+	int a = prev[id], b = next[id];
+	if (a == id) {
+		head = -1;
+		len = 0.0;
+	} else {
+		len += (a == b ? 0.0 : distance(a, b)) - distance(a, id)
+				- distance(id, b);
+		next[a] = b;
+		prev[b] = a;
+		if (head == id) {
+			head = b;
+		}
+	}
+	next[id] = prev[id] = -1;
+
+	// out of the grid and the neighbour lists
+	live[id] = false;
+	count--;
+	removeFromGrid(id);
+	for (size_t i = 0; i < near[id].size(); i++) {
+		dropNeighbour(near[id][i].second, id);
+	}
+	near[id].clear();
+	reaches.erase(reaches.find(reach[id]));
+	// every fiber that had it as a candidate, which includes the ones
+	// whose list held it
+	std::vector<int> reaching = reachingPosition(positionOf(id), id);
+	for (size_t i = 0; i < reaching.size(); i++) {
+		refillNeighbours(reaching[i]);
+	}
+	listedBy[id].clear();
+	all[id].clear();
+	arrays[id] = stateArray();
+	return true;
+}
+
+std::vector<unsigned int> fiberTour::tour() const {
+	std::vector<unsigned int> path;
+	if (head < 0) {
+		return path;
+	}
+	// from the oldest fiber, the smallest id
+	int start = head;
+	for (int f = next[head]; f != head; f = next[f]) {
+		start = std::min(start, f);
+	}
+	path.push_back(start);
+	for (int f = next[start]; f != start; f = next[f]) {
+		path.push_back(f);
+	}
+	path.push_back(start);
+	return path;
+}
+
+void fiberTour::compact(std::vector<fiber> &fibers,
+		std::vector<unsigned int> &tour, std::vector<int> &ids) const {
+	fibers.clear();
+	ids.clear();
+	std::vector<unsigned int> position(all.size(), 0);
+	for (size_t f = 0; f < all.size(); f++) {
+		if (live[f]) {
+			position[f] = static_cast<unsigned int>(ids.size());
+			ids.push_back(static_cast<int>(f));
+			fibers.push_back(all[f]);
+		}
+	}
+	// tour() starts at the smallest id, which is position 0
+	tour = this->tour();
+	for (size_t i = 0; i < tour.size(); i++) {
+		tour[i] = position[tour[i]];
+	}
+}
+
+bool fiberTour::adopt(const std::vector<unsigned int> &tour,
+		const std::vector<int> &ids) {
+	if (ids.size() != count || tour.size() != (count ? count + 1 : 0)
+			|| (count && tour.front() != tour.back())) {
+		return false;
+	}
+	std::vector<int> order;
+	std::vector<bool> seen(all.size(), false);
+	for (size_t i = 0; i + 1 < tour.size(); i++) {
+		if (tour[i] >= ids.size()) {
+			return false;
+		}
+		int f = ids[tour[i]];
+		if (!contains(f) || seen[f]) {
+			return false;
+		}
+		seen[f] = true;
+		order.push_back(f);
+	}
+	len = 0.0;
+	for (size_t i = 0; i < order.size(); i++) {
+		int a = order[i], b = order[(i + 1) % order.size()];
+		next[a] = b;
+		prev[b] = a;
+		len += (a == b) ? 0.0 : distance(a, b);
+	}
+	head = order.empty() ? -1 : order[0];
+	return true;
+}
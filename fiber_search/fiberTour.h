@@ -0,0 +1,124 @@
+/*
+ * fiberTour.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef FIBERTOUR_H_
+#define FIBERTOUR_H_
+
+#include <stdint.h>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "state.h"
+#include "se3kernel.h"
+
+class fiberTour {
+	/*
+	 * A fiber tour that follows small changes of the fiber set. It keeps
+	 * the k closest fibers (by fiber distance) of every fiber, a hash grid
+	 * over the fiber positions to find candidates for them, and the tour as
+	 * a doubly linked cycle. As in knnFiberGraph a list is the k closest
+	 * of the CANDIDATE_FACTOR * k fibers nearest by position. Inserting a
+	 * fiber puts it into the cheapest gap next to one of its neighbours,
+	 * removing one splices it out of the cycle, and both refill the lists
+	 * of the fibers whose candidates it enters or leaves, so the lists stay
+	 * those a rebuild would find. That is about CANDIDATE_FACTOR * k lists
+	 * of CANDIDATE_FACTOR * k distance evaluations each (64 x 64 with the
+	 * defaults), far less than rebuilding the graph or re-solving the tour.
+	 * To recover what the greedy repairs lose, improveTour can be run now
+	 * and then on the compact() form of the set and the result adopt()ed.
+	 *
+	 * Fibers keep their id (their index in the initial vector, then the
+	 * order of insertion) for as long as they are in the set, so after a
+	 * removal the ids have gaps.
+	 */
+public:
+	// the fibers and a closed tour of them (from solveTSP or improveTour),
+	// throws std::invalid_argument if the tour misses a fiber
+	fiberTour(const std::vector<fiber> &fibers,
+			const std::vector<unsigned int> &tour, int k = 16);
+
+	// add a fiber, its id; -1 for a fiber without states
+	int insert(const fiber &f);
+	// remove a fiber, false if there is no such fiber
+	bool remove(int id);
+
+	size_t size() const {
+		return count;
+	}
+	bool contains(int id) const {
+		return id >= 0 && id < static_cast<int>(live.size()) && live[id];
+	}
+	// every fiber by id, removed fibers are empty
+	const std::vector<fiber> &fibers() const {
+		return all;
+	}
+	// the k closest fibers of a fiber, nearest first
+	std::vector<int> neighbours(int id) const;
+
+	// the tour closed like solveTSP's, from the oldest fiber still in it
+	std::vector<unsigned int> tour() const;
+	// the set with its ids compacted to 0 .. size() - 1, as fiberSet and
+	// improveTour take it: the fibers in id order, the tour over their
+	// positions in fibers and the id of every position
+	void compact(std::vector<fiber> &fibers, std::vector<unsigned int> &tour,
+			std::vector<int> &ids) const;
+	// replace the cycle by a closed tour over compact positions (such as
+	// improveTour's result), false if it does not visit every fiber once
+	bool adopt(const std::vector<unsigned int> &tour,
+			const std::vector<int> &ids);
+	// its length, kept up to date by the repairs
+	double length() const {
+		return len;
+	}
+
+private:
+	typedef std::vector<std::pair<double, int> > neighbourList;
+
+	double distance(int a, int b) const;
+	const double *positionOf(int id) const {
+		return &position[3 * id];
+	}
+	int64_t cellKey(const double *p) const;
+	void addToGrid(int id);
+	void removeFromGrid(int id);
+	// the m fibers nearest to p by position, other than exclude
+	std::vector<int> nearestByPosition(const double *p, size_t m,
+			int exclude) const;
+	// the fibers whose candidates reach p, other than exclude
+	std::vector<int> reachingPosition(const double *p, int exclude) const;
+	int addFiber(const fiber &f);
+	void fillNeighbours(int id);
+	// fillNeighbours for a fiber in the set, keeping listedBy and reaches
+	void refillNeighbours(int id);
+	void dropNeighbour(int id, int other);
+
+	int k;
+	std::vector<fiber> all;
+	std::vector<stateArray> arrays;
+	std::vector<double> position; // 3 per fiber, that of its first state
+	std::vector<bool> live;
+	size_t count;
+
+	double cell; // grid spacing
+	int lo[3], hi[3]; // range of occupied cells, never shrinks
+	std::unordered_map<int64_t, std::vector<int> > grid;
+
+	std::vector<neighbourList> near; // k closest, sorted by distance
+	std::vector<std::vector<int> > listedBy; // fibers whose list holds one
+	// squared position distance of the last candidate (squared so that it
+	// compares exactly), infinite if there were fewer than
+	// CANDIDATE_FACTOR * k; reaches holds those of the fibers in the set,
+	// for their maximum
+	std::vector<double> reach;
+	std::multiset<double> reaches;
+
+	std::vector<int> next, prev; // the cycle, -1 for removed fibers
+	int head;
+	double len;
+};
+
+#endif /* FIBERTOUR_H_ */
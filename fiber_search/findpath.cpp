@@ -11,12 +11,21 @@
 #include "findpath.h"
 #include "helper.h"
 #include "se3graph.h"
+#include "tourImprovement.h"
+#include "clusterTour.h"
 #include <ompl/geometric/planners/rrt/RRTConnect.h>
 #include <ompl/geometric/planners/prm/PRM.h>
 #include <ompl/geometric/planners/kpiece/LBKPIECE1.h>
 #include <iterator>
 #include <vector>
 
+// beyond this many fibers the complete fiber graph is replaced by the
+// graph of the GRAPH_NEIGHBOURS closest fibers, and beyond
+// CLUSTERED_LIMIT the tour is solved over clusters of fibers
+static const size_t DENSE_GRAPH_LIMIT = 2000;
+static const int GRAPH_NEIGHBOURS = 16;
+static const size_t CLUSTERED_LIMIT = 20000;
+
 using namespace ompl;
 namespace ob = ompl::base;
 namespace og = ompl::geometric;
@@ -84,15 +93,30 @@ void findPath(std::string obstacles, std::string robot, state start_state,
 }
 
 void findPathBetweenFibers(std::string obstacles, std::string robot,
-		std::vector<fiber> allfibers) {
+		std::vector<fiber> allfibers, double tourSeconds) {
 
 	std::vector<state> goal_states;
 
 	cout << "Computing fiber graph" << endl;
-	Graph fibgraph = fiberGraph(allfibers);
-
-	cout << "Solving TSP" << endl;
-	std::vector<unsigned int> path = solveTSP(fibgraph);
+	fiberSet fibers(allfibers);
+	std::vector<unsigned int> path;
+	if (allfibers.size() > CLUSTERED_LIMIT) {
+		cout << "Solving clustered TSP" << endl;
+		path = solveClusteredTSP(fibers);
+		if (tourSeconds > 0) {
+			cout << "Improving tour" << endl;
+			path = improveTour(path, fibers, tourSeconds);
+		}
+	} else {
+		csrGraph fibgraph = allfibers.size() <= DENSE_GRAPH_LIMIT ?
+				fiberGraph(fibers) : knnFiberGraph(fibers, GRAPH_NEIGHBOURS);
+		cout << "Solving TSP" << endl;
+		path = solveTSP(fibgraph, fibers);
+		if (tourSeconds > 0) {
+			cout << "Improving tour" << endl;
+			path = improveTour(path, fibgraph, fibers, tourSeconds);
+		}
+	}
 
 	cout << "Computing goal states for fiber path ";
 	computeStateGoals(path, allfibers, goal_states);
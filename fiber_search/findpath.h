@@ -16,10 +16,11 @@
 
 #include "state.h"
 
-// solve the motion planning problem
+// solve the motion planning problem, improving the fiber tour for
+// tourSeconds (no improvement if 0)
 
 void findPathBetweenFibers(std::string obstacles, std::string robot,
-		std::vector<fiber> allfibers);
+		std::vector<fiber> allfibers, double tourSeconds = 1.0);
 
 
 #endif
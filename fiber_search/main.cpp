@@ -9,78 +9,51 @@
  */
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <stdlib.h>
+#include <string>
 #include "se3graph.h"
 #include "findpath.h"
+#include "fiberFile.h"
 #include "state.h"
 
 using namespace std;
 
 int main(int argc, char *argv[]) {
 
-	if ((argc != 4)) {
+	if ((argc == 4) && (std::string(argv[1]) == "--convert")) {
+		// text fibers to the binary format, which later runs map directly
+		fiberTable table;
+		if (!readFiberText(argv[2], table)) {
+			cout << "Cannot read fibers from " << argv[2] << endl;
+			exit(1);
+		}
+		if (!writeFiberFile(argv[3], table)) {
+			cout << "Cannot write fibers to " << argv[3] << endl;
+			exit(1);
+		}
+		cout << "Wrote " << table.fibers() << " fibers with "
+				<< table.orientation.size() << " states to " << argv[3]
+				<< endl;
+		return 0;
+	}
+	if ((argc != 4) && (argc != 5)) {
 		cout << "Number of arguments = " << argc << endl;
 		cout << "usage = " << endl;
-		cout << "./fiberSearch obstacle robot fibers \n" << endl;
+		cout << "./fiberSearch obstacle robot fibers [tour seconds]" << endl;
+		cout << "./fiberSearch --convert fibers.txt fibers.bin\n" << endl;
 		exit(1);
 	}
+	// time spent improving the fiber tour
+	double tourSeconds = (argc == 5) ? atof(argv[4]) : 1.0;
 
-	// read path and transform states
-	std::ifstream infile(argv[3]);
-	std::string line;
+	// fibers from text or from the binary format
 	cout << "Reading fibers" << endl;
-
-	// store a vector of fibers
-	std::vector<fiber> allfibers;
-	while (std::getline(infile, line)) {
-		std::istringstream iss(line);
-		std::istringstream ori(line);
-		int columns = 0;
-
-		double x, y, z = 0;
-		iss >> x >> y >> z;
-
-		do {
-			std::string sub;
-			iss >> sub;
-			if (sub.length())
-				++columns;
-		} while (iss);
-
-		ori >> x >> y >> z;
-
-		int norientations = (columns) / 4;
-		fiber f;
-		for (int i = 0; i < norientations; i++) {
-			state s;
-			s.x = x;
-			s.y = y;
-			s.z = z;
-
-			// Ensure that the orientation entries are unit quaternions
-			double qx, qy, qz, qw = 0;
-			ori >> qx >> qy >> qz >> qw;
-			Eigen::Quaterniond q;
-			q.x() = qx;
-			q.y() = qy;
-			q.z() = qz;
-			q.w() = qw;
-			q.normalize();
-			s.qx = q.x();
-			s.qy = q.y();
-			s.qz = q.z();
-			s.qw = q.w();
-
-			f.push_back(s);
-		}
-		allfibers.push_back(f);
-	}
+	std::vector<fiber> allfibers = readFibers(argv[3]);
 
 	std::string obstacle(argv[1]);
 	std::string robot(argv[2]);
 
-	findPathBetweenFibers(obstacle, robot, allfibers);
+	findPathBetweenFibers(obstacle, robot, allfibers, tourSeconds);
 
 	return 0;
 
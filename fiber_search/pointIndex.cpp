@@ -0,0 +1,130 @@
+/*
+ * pointIndex.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+
+#include "pointIndex.h"
+
+pointIndex::pointIndex(const std::vector<double> &xyz) {
+	int n = static_cast<int>(xyz.size() / 3);
+	order.resize(n);
+	for (int i = 0; i < n; i++) {
+		order[i] = i;
+	}
+	points = xyz;
+	axis.assign(n, 0);
+	build(0, n);
+	// store the coordinates in tree order for the queries
+	std::vector<double> sorted(3 * n);
+	for (int i = 0; i < n; i++) {
+		std::copy(&xyz[3 * order[i]], &xyz[3 * order[i]] + 3, &sorted[3 * i]);
+	}
+	points.swap(sorted);
+}
+
+void pointIndex::build(int lo, int hi) {
+	// split [lo, hi) at its median along the widest axis; coordinates are
+	// still in input order here, looked up through order
+	if (hi - lo <= 1) {
+		return;
+	}
+	double mn[3], mx[3];
+	for (int a = 0; a < 3; a++) {
+		mn[a] = mx[a] = points[3 * order[lo] + a];
+	}
+	for (int i = lo + 1; i < hi; i++) {
+		for (int a = 0; a < 3; a++) {
+			mn[a] = std::min(mn[a], points[3 * order[i] + a]);
+			mx[a] = std::max(mx[a], points[3 * order[i] + a]);
+		}
+	}
+	int a = 0;
+	for (int b = 1; b < 3; b++) {
+		if (mx[b] - mn[b] > mx[a] - mn[a]) {
+			a = b;
+		}
+	}
+	int mid = (lo + hi) / 2;
+	const std::vector<double> &pts = points;
+	std::nth_element(order.begin() + lo, order.begin() + mid,
+			order.begin() + hi, [&pts, a](int u, int v) {
+				return pts[3 * u + a] < pts[3 * v + a];
+			});
+	axis[mid] = static_cast<char>(a);
+	build(lo, mid);
+	build(mid + 1, hi);
+}
+
+double pointIndex::squaredDistance(const double *p, int i) const {
+	double dx = points[3 * i] - p[0];
+	double dy = points[3 * i + 1] - p[1];
+	double dz = points[3 * i + 2] - p[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+void pointIndex::nearest(const double *p, int lo, int hi, int k,
+		std::vector<std::pair<double, int> > &heap) const {
+	// heap is a max heap of the best k (squared distance, slot)
+	if (lo >= hi) {
+		return;
+	}
+	int mid = (lo + hi) / 2;
+	double d2 = squaredDistance(p, mid);
+	if (static_cast<int>(heap.size()) < k) {
+		heap.push_back(std::make_pair(d2, mid));
+		std::push_heap(heap.begin(), heap.end());
+	} else if (d2 < heap.front().first) {
+		std::pop_heap(heap.begin(), heap.end());
+		heap.back() = std::make_pair(d2, mid);
+		std::push_heap(heap.begin(), heap.end());
+	}
+	int a = axis[mid];
+	double diff = p[a] - points[3 * mid + a];
+	// the side holding p first, the other only if it can still improve
+	int nlo = diff < 0 ? lo : mid + 1, nhi = diff < 0 ? mid : hi;
+	int flo = diff < 0 ? mid + 1 : lo, fhi = diff < 0 ? hi : mid;
+	nearest(p, nlo, nhi, k, heap);
+	if (static_cast<int>(heap.size()) < k || diff * diff < heap.front().first) {
+		nearest(p, flo, fhi, k, heap);
+	}
+}
+
+std::vector<int> pointIndex::nearest(const double *p, int k) const {
+	std::vector<std::pair<double, int> > heap;
+	heap.reserve(k + 1);
+	nearest(p, 0, static_cast<int>(order.size()), k, heap);
+	std::sort_heap(heap.begin(), heap.end());
+	std::vector<int> result(heap.size());
+	for (size_t i = 0; i < heap.size(); i++) {
+		result[i] = order[heap[i].second];
+	}
+	return result;
+}
+
+void pointIndex::within(const double *p, int lo, int hi, double r2,
+		std::vector<int> &out) const {
+	if (lo >= hi) {
+		return;
+	}
+	int mid = (lo + hi) / 2;
+	if (squaredDistance(p, mid) <= r2) {
+		out.push_back(order[mid]);
+	}
+	int a = axis[mid];
+	double diff = p[a] - points[3 * mid + a];
+	if (diff <= 0 || diff * diff <= r2) {
+		within(p, lo, mid, r2, out);
+	}
+	if (diff >= 0 || diff * diff <= r2) {
+		within(p, mid + 1, hi, r2, out);
+	}
+}
+
+std::vector<int> pointIndex::within(const double *p, double radius) const {
+	std::vector<int> out;
+	within(p, 0, static_cast<int>(order.size()), radius * radius, out);
+	return out;
+}
@@ -0,0 +1,47 @@
+/*
+ * pointIndex.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef POINTINDEX_H_
+#define POINTINDEX_H_
+
+#include <vector>
+
+class pointIndex {
+	/*
+	 * Static kd-tree over points in R^3 (fiber positions). The tree is
+	 * implicit: the points are permuted so that every subrange is split at
+	 * its median along its widest axis, no nodes are allocated. Queries are
+	 * read only and can run from many threads.
+	 */
+public:
+	pointIndex() {
+	}
+	// xyz holds 3 coordinates per point
+	explicit pointIndex(const std::vector<double> &xyz);
+
+	size_t size() const {
+		return order.size();
+	}
+
+	// the k points closest to p (by euclidean distance), nearest first
+	std::vector<int> nearest(const double *p, int k) const;
+	// all points within radius of p, in no particular order
+	std::vector<int> within(const double *p, double radius) const;
+
+private:
+	void build(int lo, int hi);
+	void nearest(const double *p, int lo, int hi, int k,
+			std::vector<std::pair<double, int> > &heap) const;
+	void within(const double *p, int lo, int hi, double r2,
+			std::vector<int> &out) const;
+	double squaredDistance(const double *p, int i) const;
+
+	std::vector<double> points; // 3 per point, in tree order
+	std::vector<int> order;     // original index of every tree slot
+	std::vector<char> axis;     // split axis of the subrange centred on a slot
+};
+
+#endif /* POINTINDEX_H_ */
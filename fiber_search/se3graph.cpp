@@ -6,184 +6,408 @@
  */
 
 #include "se3graph.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
-#include <boost/graph/metric_tsp_approx.hpp>
+#include "pointIndex.h"
 
 using namespace std;
-using namespace boost;
 
-typedef boost::graph_traits<Graph>::vertex_descriptor vertex_descriptor;
-typedef boost::graph_traits<Graph>::edge_descriptor edge_descriptor;
-typedef vector<graph_traits<Graph>::vertex_descriptor> vcontainer;
+csrGraph fiberGraph(std::vector<fiber> fibers) {
+	// intern the orientation sets, the edge weights are then table lookups
+	return fiberGraph(fiberSet(fibers));
+}
 
-struct mvisitor: boost::default_dfs_visitor {
-	template<typename Graph>
-	void tree_edge(Edge e, const Graph& g) {
-		std::cout << "traversing: " << e << " with weight "
-				<< get(boost::edge_weight, g, e) << "\n";
+csrGraph fiberGraph(const fiberSet &fibers) {
+
+	// every pair of fibers is an edge weighted by fiber distance
+	int n = static_cast<int>(fibers.size());
+	std::vector<weightedEdge> edges;
+	edges.reserve(static_cast<size_t>(n) * (n - 1) / 2);
+	for (int i = 0; i < n; i++) {
+		for (int j = i + 1; j < n; j++) {
+			weightedEdge e;
+			e.u = i;
+			e.v = j;
+			e.w = fibers.distance(i, j);
+			edges.push_back(e);
+		}
 	}
-};
+	return csrGraph(n, edges);
+}
 
-void PrintEdges(Graph g, const char* name) {
+// candidates per neighbour in knnFiberGraph
+static const int CANDIDATE_FACTOR = 4;
+
+csrGraph knnFiberGraph(const fiberSet &fibers, int k) {
+	// each fiber computes exact distances only to its CANDIDATE_FACTOR * k
+	// nearest fibers by position and keeps the k closest; the queries run
+	// in parallel and the edges are merged into one sparse graph
+	int n = static_cast<int>(fibers.size());
+	pointIndex index(fibers.positions());
+	int candidates = std::min(n, CANDIDATE_FACTOR * k + 1);
+	std::vector<std::vector<std::pair<double, int> > > neighbours(n);
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < n; i++) {
+		std::vector<int> near = index.nearest(fibers.positionOf(i),
+				candidates);
+		std::vector<std::pair<double, int> > &best = neighbours[i];
+		for (size_t c = 0; c < near.size(); c++) {
+			if (near[c] != i) {
+				best.push_back(std::make_pair(fibers.distance(i, near[c]),
+						near[c]));
+			}
+		}
+		size_t keep = std::min(best.size(), static_cast<size_t>(k));
+		std::partial_sort(best.begin(), best.begin() + keep, best.end());
+		best.resize(keep);
+	}
 
-	cout << "Printing graph structure for " << name << endl;
-	cout << "---------------------------------------" << endl;
-	typedef graph_traits<Graph>::edge_iterator edge_iter;
-	std::pair<edge_iter, edge_iter> edgePair;
-	property_map<Graph, edge_weight_t>::type EdgeWeightMap = get(
-			edge_weight_t(), g);
+	// an edge from either fiber that found it, the graph keeps it once
+	std::vector<weightedEdge> edges;
+	for (int i = 0; i < n; i++) {
+		for (size_t c = 0; c < neighbours[i].size(); c++) {
+			weightedEdge e;
+			e.u = i;
+			e.v = neighbours[i][c].second;
+			e.w = neighbours[i][c].first;
+			edges.push_back(e);
+		}
+		std::vector<std::pair<double, int> >().swap(neighbours[i]);
+	}
+	csrGraph g(n, edges);
+	cout << "fiber graph with " << g.edges() << " edges (" << k
+			<< " nearest fibers)" << endl;
+	return g;
+}
 
-	for (edgePair = edges(g); edgePair.first != edgePair.second;
-			++edgePair.first) {
-		std::cout << *(edgePair.first) << "-->"
-				<< EdgeWeightMap[*edgePair.first] << std::endl;
+static int findRoot(std::vector<int> &parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
 	}
+	return i;
+}
 
-	std::cout << std::endl;
+static bool lighter(const weightedEdge &a, const weightedEdge &b) {
+	return a.w < b.w;
 }
 
-Graph fiberGraph(std::vector<fiber> fibers) {
+static std::vector<weightedEdge> spanningForest(const csrGraph &g,
+		std::vector<int> &parent) {
+	// Kruskal over the edge list, parent is left as the union-find forest
+	// of the components
+	std::vector<weightedEdge> edges = g.edgeList();
+	std::sort(edges.begin(), edges.end(), lighter);
+	parent.resize(g.n);
+	for (int i = 0; i < g.n; i++) {
+		parent[i] = i;
+	}
+	std::vector<weightedEdge> forest;
+	size_t treeEdges = g.n > 0 ? g.n - 1 : 0;
+	for (size_t e = 0; e < edges.size() && forest.size() < treeEdges; e++) {
+		int ru = findRoot(parent, edges[e].u);
+		int rv = findRoot(parent, edges[e].v);
+		if (ru != rv) {
+			parent[ru] = rv;
+			forest.push_back(edges[e]);
+		}
+	}
+	return forest;
+}
+
+static std::vector<std::vector<int> > spanningTree(const csrGraph &g,
+		const fiberSet &fibers) {
+	int n = g.n;
+
+	// 1. spanning forest of the graph
+	std::vector<int> parent;
+	std::vector<weightedEdge> forest = spanningForest(g, parent);
+	std::vector<std::vector<int> > tree(n);
+	for (size_t e = 0; e < forest.size(); e++) {
+		tree[forest[e].u].push_back(forest[e].v);
+		tree[forest[e].v].push_back(forest[e].u);
+	}
 
-	// create a graph and add all fibers as nodes.
-	Graph g(fibers.size()); // Create a graph with as many vertices as there are fibers
+	// 2. join the trees (Boruvka rounds): every tree links its first
+	// fiber to the closest fiber of another tree among the nearest by
+	// position, with distances computed on demand
+	pointIndex index(fibers.positions());
+	int joined = 0;
+	while (true) {
+		std::vector<int> first(n, -1);
+		int trees = 0;
+		for (int i = 0; i < n; i++) {
+			int r = findRoot(parent, i);
+			if (first[r] < 0) {
+				first[r] = i;
+				trees++;
+			}
+		}
+		if (trees == 1) {
+			break;
+		}
+		std::vector<std::pair<int, int> > links;
+		for (int r = 0; r < n; r++) {
+			if (first[r] < 0) {
+				continue;
+			}
+			int u = first[r];
+			int best = -1;
+			double bestDistance = 0;
+			for (int m = 8; best < 0; m = std::min(n, 4 * m)) {
+				std::vector<int> near = index.nearest(fibers.positionOf(u), m);
+				for (size_t c = 0; c < near.size(); c++) {
+					if (findRoot(parent, near[c]) == r) {
+						continue;
+					}
+					double d = fibers.distance(u, near[c]);
+					if (best < 0 || d < bestDistance) {
+						best = near[c];
+						bestDistance = d;
+					}
+				}
+				if (m == n) {
+					break;
+				}
+			}
+			links.push_back(std::make_pair(u, best));
+		}
+		for (size_t l = 0; l < links.size(); l++) {
+			int u = links[l].first, v = links[l].second;
+			int ru = findRoot(parent, u), rv = findRoot(parent, v);
+			if (ru != rv) {
+				parent[ru] = rv;
+				tree[u].push_back(v);
+				tree[v].push_back(u);
+				joined++;
+			}
+		}
+	}
+	if (joined > 0) {
+		cout << "joined " << joined + 1 << " components of the fiber graph"
+				<< endl;
+	}
 
-	// now populate the graph by creating edges between every pair of nodes
-	for (auto i = fibers.begin(); i != fibers.end(); i++) {
-		for (auto j = fibers.begin(); j != fibers.end(); j++) {
-			unsigned int findex_i = std::distance(fibers.begin(), i);
-			unsigned int findex_j = std::distance(fibers.begin(), j);
+	return tree;
+}
 
-			if ((i < j)) {
-				// weight the edge by fiber distance
-				EdgeWeightProperty e1 = fiberDistance(*i, *j);
-				add_edge(findex_i, findex_j, e1, g);
+static std::vector<unsigned int> walkTree(
+		const std::vector<std::vector<int> > &tree, int from, int to) {
+	// preorder walk of the tree from a vertex. With an end vertex the
+	// branch towards it is taken last at every vertex on the way, and the
+	// end itself comes after its other branches, so the walk stops there;
+	// every tree edge is still followed at most twice
+	int n = static_cast<int>(tree.size());
+	std::vector<bool> towards(n, false);
+	if (to >= 0) {
+		std::vector<int> parent(n, -1);
+		std::vector<int> queue(1, from);
+		parent[from] = from;
+		for (size_t q = 0; q < queue.size(); q++) {
+			int u = queue[q];
+			for (size_t c = 0; c < tree[u].size(); c++) {
+				if (parent[tree[u][c]] < 0) {
+					parent[tree[u][c]] = u;
+					queue.push_back(tree[u][c]);
+				}
 			}
+		}
+		for (int u = to; u != from; u = parent[u]) {
+			towards[u] = true;
+		}
+	}
 
+	// entries ~u emit u after the branches pushed above them
+	std::vector<unsigned int> path;
+	std::vector<bool> visited(n, false);
+	std::vector<int> stack(1, from);
+	while (!stack.empty()) {
+		int u = stack.back();
+		stack.pop_back();
+		if (u < 0) {
+			path.push_back(~u);
+			continue;
+		}
+		if (visited[u]) {
+			continue;
+		}
+		visited[u] = true;
+		if (u == to) {
+			stack.push_back(~u);
+		} else {
+			path.push_back(u);
+		}
+		for (size_t c = 0; c < tree[u].size(); c++) {
+			int v = tree[u][c];
+			if (!visited[v] && towards[v]) {
+				stack.push_back(v);
+			}
+		}
+		for (size_t c = tree[u].size(); c-- > 0;) {
+			int v = tree[u][c];
+			if (!visited[v] && !towards[v]) {
+				stack.push_back(v);
+			}
 		}
 	}
-	//const char* name = "fiber graph ";
-	//PrintEdges(g, name);
-	return g;
+	return path;
 }
 
-std::vector<unsigned int> solveTSP(Graph g) {
+std::vector<unsigned int> mstTour(const csrGraph &g, const fiberSet &fibers) {
+	std::vector<unsigned int> path;
+	if (g.n == 0) {
+		return path;
+	}
+	// back to the start like metric_tsp_approx
+	path = walkTree(spanningTree(g, fibers), 0, -1);
+	path.push_back(0);
+	return path;
+}
 
-	// compute the traveling salesman problem on the fiber graph
-	typedef property_map<Graph, edge_weight_t>::type WeightMap;
-	WeightMap weight_map(get(edge_weight, g));
+std::vector<unsigned int> mstPath(const csrGraph &g, const fiberSet &fibers,
+		int from, int to) {
+	if (g.n == 0) {
+		return std::vector<unsigned int>();
+	}
+	return walkTree(spanningTree(g, fibers), from, to);
+}
 
-	vcontainer c;
+std::vector<unsigned int> solveTSP(const csrGraph &g, const fiberSet &fibers) {
+	std::vector<unsigned int> path = mstTour(g, fibers);
+	lazyFiberMetric metric(g, fibers);
 	double len = 0.0;
+	for (size_t i = 0; i + 1 < path.size(); i++) {
+		len += metric(path[i], path[i + 1]);
+	}
+	cout << "tour length " << len << endl;
+	return path;
+}
 
-	// Run the TSP approx, creating the visitor on the fly.
-	metric_tsp_approx(g,
-			make_tsp_tour_len_visitor(g, back_inserter(c), len, weight_map));
-
-	std::vector<unsigned int> path;
+std::vector<state> selectTourStates(const std::vector<unsigned int> &order,
+		const std::vector<fiber> &fibers, double &length) {
+	// Viterbi over the fibers in order: cost[j] is the shortest path
+	// ending in state j of the current fiber, from[k][j] the state of
+	// fiber k - 1 it came from. One step is a min-plus product of the
+	// previous costs with the distance matrix between the two fibers,
+	// run over the states of the current fiber so it vectorises.
+	std::vector<int> seq;
+	for (size_t k = 0; k < order.size(); k++) {
+		if (!fibers[order[k]].empty()) {
+			seq.push_back(order[k]);
+		}
+	}
+	std::vector<state> chosen;
+	length = 0.0;
+	if (seq.empty()) {
+		return chosen;
+	}
 
-	for (vcontainer::iterator itr = c.begin(); itr != c.end(); ++itr) {
-		path.push_back(c[*itr]);
+	std::vector<std::vector<int> > from(seq.size());
+	stateArray previous(fibers[seq[0]]);
+	std::vector<double> cost(previous.size(), 0.0), next, dist;
+	for (size_t k = 1; k < seq.size(); k++) {
+		stateArray current(fibers[seq[k]]);
+		int p = static_cast<int>(previous.size());
+		int q = static_cast<int>(current.size());
+		dist.resize(static_cast<size_t>(p) * q);
+		se3Distances(previous, current, &dist[0]);
+		next.assign(q, 0.0);
+		from[k].assign(q, 0);
+		double *best = &next[0];
+		int *arg = &from[k][0];
+		for (int j = 0; j < q; j++) {
+			best[j] = cost[0] + dist[j];
+		}
+		for (int i = 1; i < p; i++) {
+			const double *row = &dist[static_cast<size_t>(i) * q];
+			double ci = cost[i];
+#pragma omp simd
+			for (int j = 0; j < q; j++) {
+				double c = ci + row[j];
+				arg[j] = c < best[j] ? i : arg[j];
+				best[j] = c < best[j] ? c : best[j];
+			}
+		}
+		cost.swap(next);
+		previous = current;
 	}
 
-	return path;
+	// walk the choices back from the cheapest final state
+	int j = static_cast<int>(std::min_element(cost.begin(), cost.end())
+			- cost.begin());
+	length = cost[j];
+	chosen.resize(seq.size());
+	for (size_t k = seq.size(); k-- > 0;) {
+		chosen[k] = fibers[seq[k]][j];
+		if (k > 0) {
+			j = from[k][j];
+		}
+	}
+	return chosen;
 }
 
 std::vector<state> computeStateGoals(vector<unsigned int> path,
 		std::vector<fiber> fibers,  vector<state> &goals) {
 	// Given a path of vertices (fiber sequence) to traverse, and a reference state
 	// compute the sequence of states which need to be traversed
-	// by the tool to avoid collisions (in a greedy way)
-
-	std::vector<state> goal_states;
-	double mindist = 1e10;
+	// by the tool to avoid collisions, one state per fiber
 
-	// make pairs from the path
-	std::vector<std::pair<int, int>> num_pairs;
-	if (!path.empty()) {
-		std::transform(std::begin(path), std::prev(std::end(path)),
-				std::next(std::begin(path)), std::back_inserter(num_pairs),
-				std::make_pair<decltype(path)::const_reference,
-						decltype(path)::const_reference>);
-	}
-	// now iterate
-	for (auto i = num_pairs.begin(); i != std::prev(num_pairs.end()); i++) {
-
-		auto fiberpair = *i;
-		if(i == num_pairs.begin()){
-			cout << fiberpair.first << "-->" << fiberpair.second;
-		}
-		else {
-			cout << "-->" << fiberpair.second;
-		}
-
-		std::vector<state> closest = closestStates(fibers[fiberpair.first],
-				fibers[fiberpair.second]);
-
-		goals.insert(goals.end(), closest.begin(), closest.end());
+	// the tour is walked up to its last fiber, not back to the start
+	std::vector<unsigned int> order(path.begin(),
+			path.empty() ? path.end() : std::prev(path.end()));
+	for (size_t k = 0; k < order.size(); k++) {
+		cout << (k > 0 ? "-->" : "") << order[k];
 	}
 	cout << endl;
 
+	double length;
+	std::vector<state> chosen = selectTourStates(order, fibers, length);
+	cout << chosen.size() << " goal states, path length " << length << endl;
+	goals.insert(goals.end(), chosen.begin(), chosen.end());
+
 	return goals;
 
 }
 
 
 
-std::vector<Edge> computeMST(Graph g) {
+std::vector<weightedEdge> computeMST(const csrGraph &g) {
 	// use Kruskal's algorithm to find the minimal spanning tree
 
-	property_map<Graph, edge_weight_t>::type weight = get(edge_weight, g);
-	std::vector<Edge> spanning_tree;
-
-	kruskal_minimum_spanning_tree(g, std::back_inserter(spanning_tree));
+	std::vector<int> parent;
+	std::vector<weightedEdge> spanning_tree = spanningForest(g, parent);
 
 	std::cout << "Print the edges in the MST:" << std::endl;
-	for (std::vector<Edge>::iterator ei = spanning_tree.begin();
-			ei != spanning_tree.end(); ++ei) {
-		std::cout << source(*ei, g) << " <--> " << target(*ei, g)
-				<< " with weight of " << weight[*ei] << std::endl;
+	for (size_t e = 0; e < spanning_tree.size(); e++) {
+		std::cout << spanning_tree[e].u << " <--> " << spanning_tree[e].v
+				<< " with weight of " << spanning_tree[e].w << std::endl;
 	}
 
 	// write an image of the graph as dot file
 	// then do dot -Tps kruskal-eg.dot -o outfile.ps in the figs directory
+	std::vector<std::pair<int, int> > inTree;
+	for (size_t e = 0; e < spanning_tree.size(); e++) {
+		inTree.push_back(std::make_pair(spanning_tree[e].u, spanning_tree[e].v));
+	}
+	std::sort(inTree.begin(), inTree.end());
 	std::ofstream fout("figs/kruskal-eg.dot");
 	fout << "graph A {\n" << " rankdir=LR\n" << " size=\"3,3\"\n"
 			<< " ratio=\"filled\"\n" << " edge[style=\"bold\"]\n"
 			<< " node[shape=\"circle\"]\n";
-	graph_traits<Graph>::edge_iterator eiter, eiter_end;
-	for (boost::tie(eiter, eiter_end) = edges(g); eiter != eiter_end; ++eiter) {
-		fout << source(*eiter, g) << " -- " << target(*eiter, g);
-		if (std::find(spanning_tree.begin(), spanning_tree.end(), *eiter)
-				!= spanning_tree.end())
-			fout << "[color=\"black\", label=\"" << get(edge_weight, g, *eiter)
-					<< "\"];\n";
+	std::vector<weightedEdge> edges = g.edgeList();
+	for (size_t e = 0; e < edges.size(); e++) {
+		fout << edges[e].u << " -- " << edges[e].v;
+		if (std::binary_search(inTree.begin(), inTree.end(),
+				std::make_pair(edges[e].u, edges[e].v)))
+			fout << "[color=\"black\", label=\"" << edges[e].w << "\"];\n";
 		else
-			fout << "[color=\"gray\", label=\"" << get(edge_weight, g, *eiter)
-					<< "\"];\n";
+			fout << "[color=\"gray\", label=\"" << edges[e].w << "\"];\n";
 	}
 	fout << "}\n";
 
-	/*
-	 * DFS MST
-	 *
-	 *
-	 struct InSpanning {
-	 std::set<Edge> edges;
-	 bool operator()(Edge e) const {
-	 return edges.count(e);
-	 }
-	 } spanning;
-	 *
-	 *
-	 * kruskal_minimum_spanning_tree(g,
-	 std::inserter(spanning.edges, spanning.edges.end()));
-
-	 mvisitor vis;
-	 filtered_graph<Graph, InSpanning, boost::keep_all> mst(g, spanning, { });
-	 depth_first_search(mst, visitor(vis));*/
-
 	return spanning_tree;
 
 }
@@ -9,35 +9,37 @@
 #define SE3GRAPH_H_
 
 #include "se3metrics.h"
+#include "fiberSet.h"
+#include "csrGraph.h"
 
 // STL
 #include <iostream>                  // for std::cout
 
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/undirected_graph.hpp>// A subclass to provide reasonable arguments to adjacency_list for a typical undirected graph
-#include <boost/graph/graph_traits.hpp>
-
-#include <boost/graph/filtered_graph.hpp>
-#include <boost/graph/graph_utility.hpp>
-#include <boost/graph/prim_minimum_spanning_tree.hpp>
-#include <boost/graph/kruskal_min_spanning_tree.hpp>
-#include <boost/graph/dijkstra_shortest_paths.hpp>
-
-
-typedef boost::property<boost::edge_weight_t, double> EdgeWeightProperty;
-typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
-		boost::no_property, EdgeWeightProperty> Graph;
-
-using GraphType = boost::adjacency_list<boost::setS, // OutEdgeContainer
-boost::vecS,// VertexContainer
-boost::undirectedS, boost::no_property, EdgeWeightProperty>;
-
-typedef boost::graph_traits<Graph>::edge_descriptor Edge;
-
-
-Graph fiberGraph(std::vector<fiber> fibers);
-std::vector<Edge> computeMST(Graph g);
-std::vector<unsigned int>  solveTSP(Graph g);
+// complete fiber graph, every pair of fibers joined
+csrGraph fiberGraph(std::vector<fiber> fibers);
+csrGraph fiberGraph(const fiberSet &fibers);
+// sparse graph joining every fiber to the k closest (by fiber distance) of
+// its nearest fibers by position; fiber distance is at least the distance
+// between the positions, so those are the likely neighbours
+csrGraph knnFiberGraph(const fiberSet &fibers, int k);
+
+// minimum spanning forest (Kruskal), one tree per component of g
+std::vector<weightedEdge> computeMST(const csrGraph &g);
+// tour of the fiber graph, the preorder walk of its MST back to the start
+// like boost's metric_tsp_approx; components of a sparse graph are joined
+// and tour legs missing from it are weighted with fiber distances computed
+// on demand
+std::vector<unsigned int> solveTSP(const csrGraph &g, const fiberSet &fibers);
+// the same tour without reporting its length, for parts of the input
+std::vector<unsigned int> mstTour(const csrGraph &g, const fiberSet &fibers);
+// open walk of the same tree from one fiber, ending at another (to >= 0)
+std::vector<unsigned int> mstPath(const csrGraph &g, const fiberSet &fibers,
+		int from, int to);
+
+// one state per fiber of the sequence (fibers without states skipped)
+// minimising the summed distance between consecutive states, and that sum
+std::vector<state> selectTourStates(const std::vector<unsigned int> &order,
+		const std::vector<fiber> &fibers, double &length);
 
 std::vector<state> computeStateGoals(std::vector<unsigned int> path,
 		std::vector<fiber> fibers,  std::vector<state> &goals);
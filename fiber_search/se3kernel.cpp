@@ -0,0 +1,218 @@
+/*
+ * se3kernel.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <cmath>
+#include <limits>
+
+#include "se3kernel.h"
+
+static void normalised(const state &s, double &qx, double &qy, double &qz,
+		double &qw) {
+	double n = std::sqrt(s.qx * s.qx + s.qy * s.qy + s.qz * s.qz + s.qw * s.qw);
+	qx = s.qx / n;
+	qy = s.qy / n;
+	qz = s.qz / n;
+	qw = s.qw / n;
+}
+
+stateArray::stateArray(const fiber &f) {
+	reserve(f.size());
+	for (size_t i = 0; i < f.size(); i++) {
+		push_back(f[i]);
+	}
+}
+
+void stateArray::push_back(const state &s) {
+	double a, b, c, d;
+	normalised(s, a, b, c, d);
+	x.push_back(s.x);
+	y.push_back(s.y);
+	z.push_back(s.z);
+	qx.push_back(a);
+	qy.push_back(b);
+	qz.push_back(c);
+	qw.push_back(d);
+}
+
+void stateArray::reserve(size_t n) {
+	x.reserve(n);
+	y.reserve(n);
+	z.reserve(n);
+	qx.reserve(n);
+	qy.reserve(n);
+	qz.reserve(n);
+	qw.reserve(n);
+}
+
+state stateArray::operator[](size_t i) const {
+	state s;
+	s.x = x[i];
+	s.y = y[i];
+	s.z = z[i];
+	s.qx = qx[i];
+	s.qy = qy[i];
+	s.qz = qz[i];
+	s.qw = qw[i];
+	return s;
+}
+
+#pragma omp declare simd
+static inline double halfAngle(double s, double c) {
+	// atan2(s, c) for s, c >= 0 without branches, so it vectorises (cephes
+	// atan with its range reduction done by selects)
+	const double T3P8 = 2.41421356237309504880;
+	const double MOREBITS = 6.123233995736765886130E-17;
+	double x = s / c;
+	bool big = x > T3P8, mid = x > 0.66;
+	double y = big ? M_PI_2 : (mid ? M_PI_4 : 0.0);
+	double extra = big ? MOREBITS : (mid ? 0.5 * MOREBITS : 0.0);
+	x = big ? -c / s : (mid ? (s - c) / (s + c) : x);
+	double z = x * x;
+	double p = (((-8.750608600031904122785E-1 * z - 1.615753718733365076637E1)
+			* z - 7.500855792314704667340E1) * z - 1.228866684490136173410E2)
+			* z - 6.485021904942025371773E1;
+	double q = ((((z + 2.485846490142306297962E1) * z
+			+ 1.650270098316988542046E2) * z + 4.328810604912902668951E2) * z
+			+ 4.853903996359136964868E2) * z + 1.945506571482613964425E2;
+	return y + (x * z * p / q + x) + extra;
+}
+
+#pragma omp declare simd
+static inline double squaredDistance(double ax, double ay, double az,
+		double aqx, double aqy, double aqz, double aqw, double bx, double by,
+		double bz, double bqx, double bqy, double bqz, double bqw) {
+	// relative quaternion conj(qa) * qb
+	double rw = aqw * bqw + aqx * bqx + aqy * bqy + aqz * bqz;
+	double rx = aqw * bqx - aqx * bqw - aqy * bqz + aqz * bqy;
+	double ry = aqw * bqy + aqx * bqz - aqy * bqw - aqz * bqx;
+	double rz = aqw * bqz - aqx * bqy + aqy * bqx - aqz * bqw;
+	// relative translation conj(qa) (tb - ta) conj(qa)^-1, with u = -qa.xyz
+	double dx = bx - ax, dy = by - ay, dz = bz - az;
+	double cx = -aqy * dz + aqz * dy; // u x d
+	double cy = -aqz * dx + aqx * dz;
+	double cz = -aqx * dy + aqy * dx;
+	double tx = dx + 2 * (aqw * cx + (-aqy * cz + aqz * cy));
+	double ty = dy + 2 * (aqw * cy + (-aqz * cx + aqx * cz));
+	double tz = dz + 2 * (aqw * cz + (-aqx * cy + aqy * cx));
+
+	// principal log: half angle h in [0, pi/2] from |xyz| = sin h and
+	// |w| = cos h, either sign of the quaternion gives the same rotation
+	double s2 = rx * rx + ry * ry + rz * rz;
+	double s = std::sqrt(s2);
+	double h = halfAngle(s, std::fabs(rw));
+	double tt = tx * tx + ty * ty + tz * tz;
+	double at = rx * tx + ry * ty + rz * tz; // |xyz| (a.t)
+	// (theta/2)/sin(theta/2) and (a.t)^2, both tend to their limits (1 and
+	// a bounded term whose weight vanishes) as the rotation vanishes
+	bool tiny = s < 1e-8;
+	double f = tiny ? 1.0 : h / s;
+	double parallel = tiny ? 0.0 : at * at / s2;
+	return 8 * h * h + parallel + (tt - parallel) * f * f;
+}
+
+double se3Distance(const state &s1, const state &s2) {
+	double a[4], b[4];
+	normalised(s1, a[0], a[1], a[2], a[3]);
+	normalised(s2, b[0], b[1], b[2], b[3]);
+	double d2 = squaredDistance(s1.x, s1.y, s1.z, a[0], a[1], a[2], a[3],
+			s2.x, s2.y, s2.z, b[0], b[1], b[2], b[3]);
+	return std::sqrt(d2);
+}
+
+double se3Norm(const state &s) {
+	state identity;
+	identity.x = identity.y = identity.z = 0;
+	identity.qx = identity.qy = identity.qz = 0;
+	identity.qw = 1;
+	return se3Distance(identity, s);
+}
+
+double se3ProductDistance(const state &s1, const state &s2) {
+	double a[4], b[4];
+	normalised(s1, a[0], a[1], a[2], a[3]);
+	normalised(s2, b[0], b[1], b[2], b[3]);
+	// |w| and |xyz| of conj(a) * b
+	double rw = a[3] * b[3] + a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	double rx = a[3] * b[0] - a[0] * b[3] - a[1] * b[2] + a[2] * b[1];
+	double ry = a[3] * b[1] + a[0] * b[2] - a[1] * b[3] - a[2] * b[0];
+	double rz = a[3] * b[2] - a[0] * b[1] + a[1] * b[0] - a[2] * b[3];
+	double h = halfAngle(std::sqrt(rx * rx + ry * ry + rz * rz), std::fabs(rw));
+	double dx = s2.x - s1.x, dy = s2.y - s1.y, dz = s2.z - s1.z;
+	return std::sqrt(dx * dx + dy * dy + dz * dz + 8 * h * h);
+}
+
+static void squaredDistances(const state &s, const stateArray &b,
+		double *out) {
+	// s must be normalised
+	size_t n = b.size();
+	const double *bx = b.x.data(), *by = b.y.data(), *bz = b.z.data();
+	const double *bqx = b.qx.data(), *bqy = b.qy.data();
+	const double *bqz = b.qz.data(), *bqw = b.qw.data();
+#pragma omp simd
+	for (size_t j = 0; j < n; j++) {
+		out[j] = squaredDistance(s.x, s.y, s.z, s.qx, s.qy, s.qz, s.qw, bx[j],
+				by[j], bz[j], bqx[j], bqy[j], bqz[j], bqw[j]);
+	}
+}
+
+static state normalisedState(const state &s) {
+	state t = s;
+	normalised(s, t.qx, t.qy, t.qz, t.qw);
+	return t;
+}
+
+void se3Distances(const state &s, const stateArray &b, double *out) {
+	squaredDistances(normalisedState(s), b, out);
+	size_t n = b.size();
+#pragma omp simd
+	for (size_t j = 0; j < n; j++) {
+		out[j] = std::sqrt(out[j]);
+	}
+}
+
+void se3Distances(const stateArray &a, const stateArray &b, double *out) {
+	for (size_t i = 0; i < a.size(); i++) {
+		se3Distances(a[i], b, out + i * b.size());
+	}
+}
+
+static double minSquaredDistance(const state &s, const stateArray &b,
+		std::vector<double> &buffer, int &ib) {
+	// s must be normalised
+	buffer.resize(b.size());
+	squaredDistances(s, b, buffer.data());
+	double best = std::numeric_limits<double>::infinity();
+	ib = -1;
+	for (size_t j = 0; j < b.size(); j++) {
+		if (buffer[j] < best) {
+			best = buffer[j];
+			ib = static_cast<int>(j);
+		}
+	}
+	return best;
+}
+
+double se3MinDistance(const state &s, const stateArray &b, int &ib) {
+	std::vector<double> buffer;
+	return std::sqrt(minSquaredDistance(normalisedState(s), b, buffer, ib));
+}
+
+double se3MinDistance(const stateArray &a, const stateArray &b, int &ia,
+		int &ib) {
+	std::vector<double> buffer;
+	double best = std::numeric_limits<double>::infinity();
+	ia = ib = -1;
+	for (size_t i = 0; i < a.size(); i++) {
+		int j;
+		double d2 = minSquaredDistance(a[i], b, buffer, j);
+		if (d2 < best) {
+			best = d2;
+			ia = static_cast<int>(i);
+			ib = j;
+		}
+	}
+	return std::sqrt(best);
+}
@@ -0,0 +1,70 @@
+/*
+ * se3kernel.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SE3KERNEL_H_
+#define SE3KERNEL_H_
+
+#include <vector>
+
+#include "state.h"
+
+/*
+ * Closed form of the Riemannian distance ||log(M1^-1 M2)|| (Frobenius norm
+ * of the matrix log of the relative transform) used by se3metrics. With the
+ * relative rotation by angle theta about the unit axis a and the relative
+ * translation t,
+ *
+ *   d^2 = 2 theta^2 + (a.t)^2 + |t - a (a.t)|^2 (theta/2)^2 / sin^2(theta/2)
+ *
+ * which only needs the relative quaternion and translation, no 4x4 matrices
+ * and no general matrix log. The batch entry points run over states stored
+ * as structure of arrays so the compiler vectorises them (AVX2 / AVX-512
+ * when the build targets the host cpu).
+ */
+
+struct stateArray {
+	// states as structure of arrays, quaternions normalised on insertion
+	std::vector<double> x, y, z;
+	std::vector<double> qx, qy, qz, qw;
+
+	stateArray() {
+	}
+	explicit stateArray(const fiber &f);
+
+	void push_back(const state &s);
+	void reserve(size_t n);
+	size_t size() const {
+		return x.size();
+	}
+	bool empty() const {
+		return x.empty();
+	}
+	state operator[](size_t i) const;
+};
+
+// distance between two states, same value as RiemannianDistance
+double se3Distance(const state &s1, const state &s2);
+// distance of a state from the identity, the key of compareStates
+double se3Norm(const state &s);
+
+// The log norm above is symmetric but not a metric (the triangle inequality
+// fails by up to ~30%). The product metric sqrt(|p2 - p1|^2 + 2 theta^2)
+// of positions and rotation angles is one, and bounds it:
+//   se3ProductDistance <= se3Distance <= pi/2 se3ProductDistance
+double se3ProductDistance(const state &s1, const state &s2);
+
+// distances from s to every state of b (out has b.size() entries)
+void se3Distances(const state &s, const stateArray &b, double *out);
+// distances between all pairs, out is row major a.size() x b.size()
+void se3Distances(const stateArray &a, const stateArray &b, double *out);
+
+// smallest distance from s to a state of b and its index (-1 if b is empty)
+double se3MinDistance(const state &s, const stateArray &b, int &ib);
+// smallest distance between a state of a and a state of b and their indices
+double se3MinDistance(const stateArray &a, const stateArray &b, int &ia,
+		int &ib);
+
+#endif /* SE3KERNEL_H_ */
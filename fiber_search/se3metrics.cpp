@@ -27,66 +27,38 @@ void printFiber(fiber f) {
 
 
 double RiemannianDistance(state s1, state s2) {
-	// compute the Riemannian distance between two states in SE(3)
-	Eigen::Matrix4d m1 = state2Matrix(s1);
-	Eigen::Matrix4d m2 = state2Matrix(s2);
-	// Riemannian distance
-	double dist = (m1.inverse() * m2).log().norm();
-	return dist;
+	// compute the Riemannian distance between two states in SE(3), the
+	// norm of log(m1^-1 m2) in closed form (see se3kernel.h)
+	return se3Distance(s1, s2);
 }
 
 double stateFiberDistance(state s, fiber f) {
 	// distance from a state to a fiber
-	double mindist = 1e10;
-	for (auto i = f.begin(); i != f.end(); i++) {
-		state s1 = (*i);
-		double dist = RiemannianDistance(s, s1);
-		if (dist < mindist) {
-			mindist = dist;
-		}
+	if (f.empty()) {
+		return 1e10;
 	}
-	return mindist;
-
+	int closest;
+	return se3MinDistance(s, stateArray(f), closest);
 }
 
 double fiberDistance(fiber f1, fiber f2) {
 	// compute the shortest distance between two fibers
-	double mindist = 1e10;
-	for (auto i = f1.begin(); i != f1.end(); i++) {
-		for (auto j = f2.begin(); j != f2.end(); j++) {
-
-			state s1 = (*i);
-			state s2 = (*j);
-
-			double dist = RiemannianDistance(s1, s2);
-			if (dist < mindist) {
-				mindist = dist;
-
-			}
-		}
+	if (f1.empty() || f2.empty()) {
+		return 1e10;
 	}
-	return mindist;
+	int i, j;
+	return se3MinDistance(stateArray(f1), stateArray(f2), i, j);
 }
 
 std::vector<state> closestStates(fiber f1, fiber f2) {
 	// compute the closest states between two fibers
 	state sf1;
 	state sf2;
-	double mindist = 1e10;
-	for (auto i = f1.begin(); i != f1.end(); i++) {
-		for (auto j = f2.begin(); j != f2.end(); j++) {
-
-			state s1 = (*i);
-			state s2 = (*j);
-
-			double dist = RiemannianDistance(s1, s2);
-			if (dist < mindist) {
-				mindist = dist;
-				sf1 = s1;
-				sf2 = s2;
-
-			}
-		}
+	int i, j;
+	se3MinDistance(stateArray(f1), stateArray(f2), i, j);
+	if (i >= 0) {
+		sf1 = f1[i];
+		sf2 = f2[j];
 	}
 	std::vector<state> closest;
 	closest.push_back(sf1);
@@ -13,9 +13,9 @@
 
 #include <vector>
 #include <Eigen/Dense>
-#include <unsupported/Eigen/MatrixFunctions> // for log
 
 #include "state.h"
+#include "se3kernel.h"
 
 
 
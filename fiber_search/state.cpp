@@ -9,6 +9,7 @@
 
 
 #include "state.h"
+#include "se3kernel.h"
 #include <iostream>
 
 Eigen::Matrix4d state2Matrix(state s) {
@@ -40,3 +41,8 @@ void printState(state s){
 	std::cout << s.x << "," << s.y << "," << s.z << "," << s.qx << ","
 			<< s.qy << "," << s.qz << "," << s.qw << std::endl;
 }
+
+bool compareStates::operator()(const state &lhs, const state &rhs) const {
+	// closed form log norm, see se3kernel.h
+	return se3Norm(lhs) < se3Norm(rhs);
+}
@@ -8,8 +8,8 @@
 #ifndef STATE_H_
 #define STATE_H_
 
+#include <vector>
 #include <Eigen/Dense>
-#include <unsupported/Eigen/MatrixFunctions> // for log
 
 
 
@@ -34,11 +34,8 @@ Eigen::Matrix4d state2Matrix(state s);
 void printState(state s);
 
 struct compareStates {
-	bool operator()(const state &lhs, const state &rhs) {
-		double norm1 = state2Matrix(lhs).log().norm();
-		double norm2 = state2Matrix(rhs).log().norm();
-		return (norm1 < norm2);
-	}
+	// orders states by their distance from the identity (se3Norm)
+	bool operator()(const state &lhs, const state &rhs) const;
 };
 
 #endif /* STATE_H_ */
@@ -0,0 +1,277 @@
+/*
+ * stateIndex.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "stateIndex.h"
+
+// subtrees at least this large are built as separate tasks
+static const int PARALLEL_BUILD_SIZE = 4096;
+static const int STATE_INDEX_VERSION = 1;
+
+static bool closer(const stateHit &a, const stateHit &b) {
+	return a.distance < b.distance;
+}
+
+stateIndex::stateIndex(const std::vector<fiber> &fibers) {
+	// every state once, shuffled so the vantage points are random
+	std::vector<std::pair<int, int> > items;
+	slotsOf.resize(fibers.size());
+	for (size_t f = 0; f < fibers.size(); f++) {
+		for (size_t k = 0; k < fibers[f].size(); k++) {
+			items.push_back(std::make_pair(static_cast<int>(f), static_cast<int>(k)));
+		}
+	}
+	std::mt19937 generator(1);
+	std::shuffle(items.begin(), items.end(), generator);
+
+	int n = static_cast<int>(items.size());
+	states.reserve(n);
+	fiberOf.resize(n);
+	indexOf.resize(n);
+	for (int i = 0; i < n; i++) {
+		states.push_back(fibers[items[i].first][items[i].second]);
+		fiberOf[i] = items[i].first;
+		indexOf[i] = items[i].second;
+	}
+	radius.assign(n, 0);
+
+#pragma omp parallel
+#pragma omp single
+	build(0, n);
+
+	for (size_t f = 0; f < fibers.size(); f++) {
+		slotsOf[f].resize(fibers[f].size());
+	}
+	for (int i = 0; i < n; i++) {
+		slotsOf[fiberOf[i]][indexOf[i]] = i;
+	}
+}
+
+void stateIndex::build(int lo, int hi) {
+	if (hi - lo <= 1) {
+		return;
+	}
+	// distances of the range to its vantage point, sorted around the median
+	state vantage = states[lo];
+	std::vector<std::pair<double, int> > d(hi - lo - 1);
+	for (int i = lo + 1; i < hi; i++) {
+		d[i - lo - 1] = std::make_pair(se3ProductDistance(vantage, states[i]), i);
+	}
+	int mid = lo + 1 + (hi - lo - 1) / 2;
+	std::nth_element(d.begin(), d.begin() + (mid - lo - 1), d.end());
+	radius[lo] = (mid < hi) ? d[mid - lo - 1].first : 0;
+
+	// permute the slots into the order of d
+	stateArray moved;
+	moved.reserve(d.size());
+	std::vector<int> fibers(d.size()), indices(d.size());
+	for (size_t i = 0; i < d.size(); i++) {
+		moved.push_back(states[d[i].second]);
+		fibers[i] = fiberOf[d[i].second];
+		indices[i] = indexOf[d[i].second];
+	}
+	for (size_t i = 0; i < d.size(); i++) {
+		int slot = lo + 1 + static_cast<int>(i);
+		states.x[slot] = moved.x[i];
+		states.y[slot] = moved.y[i];
+		states.z[slot] = moved.z[i];
+		states.qx[slot] = moved.qx[i];
+		states.qy[slot] = moved.qy[i];
+		states.qz[slot] = moved.qz[i];
+		states.qw[slot] = moved.qw[i];
+		fiberOf[slot] = fibers[i];
+		indexOf[slot] = indices[i];
+	}
+
+	if (hi - lo >= PARALLEL_BUILD_SIZE) {
+#pragma omp task
+		build(lo + 1, mid);
+#pragma omp task
+		build(mid, hi);
+#pragma omp taskwait
+	} else {
+		build(lo + 1, mid);
+		build(mid, hi);
+	}
+}
+
+stateHit stateIndex::hit(int slot, double distance) const {
+	stateHit h;
+	h.distance = distance;
+	h.fiber = fiberOf[slot];
+	h.index = indexOf[slot];
+	return h;
+}
+
+void stateIndex::search(const state &s, int lo, int hi, size_t k,
+		double r, std::vector<stateHit> &heap) const {
+	// heap holds the best hits so far (a max heap on distance), at most k;
+	// tau is the distance a state has to beat, the subtrees are skipped
+	// when the triangle inequality rules them out
+	if (lo >= hi) {
+		return;
+	}
+	// m (product metric) steers the search and bounds the distance from
+	// below, the distance itself is only computed when m can beat tau
+	state vantage = states[lo];
+	double m = se3ProductDistance(s, vantage);
+	double tau = (heap.size() == k) ? std::min(r, heap.front().distance) : r;
+	if (m <= tau) {
+		double d = se3Distance(s, vantage);
+		if (d <= tau && d <= r) {
+			heap.push_back(hit(lo, d));
+			std::push_heap(heap.begin(), heap.end(), closer);
+			if (heap.size() > k) {
+				std::pop_heap(heap.begin(), heap.end(), closer);
+				heap.pop_back();
+			}
+		}
+	}
+	int mid = lo + 1 + (hi - lo - 1) / 2;
+	double mu = radius[lo];
+	// states inside are within mu of the vantage point, so at least m - mu
+	// from the query; states outside at least mu - m
+	bool insideFirst = m <= mu;
+	for (int pass = 0; pass < 2; pass++) {
+		tau = (heap.size() == k) ? std::min(r, heap.front().distance) : r;
+		if (insideFirst == (pass == 0)) {
+			if (m - mu <= tau) {
+				search(s, lo + 1, mid, k, r, heap);
+			}
+		} else if (mu - m <= tau) {
+			search(s, mid, hi, k, r, heap);
+		}
+	}
+}
+
+std::vector<stateHit> stateIndex::nearest(const state &s, int k) const {
+	std::vector<stateHit> heap;
+	if (k <= 0) {
+		return heap;
+	}
+	search(s, 0, static_cast<int>(size()), k,
+			std::numeric_limits<double>::infinity(), heap);
+	std::sort_heap(heap.begin(), heap.end(), closer);
+	return heap;
+}
+
+std::vector<stateHit> stateIndex::within(const state &s, double r) const {
+	std::vector<stateHit> heap;
+	search(s, 0, static_cast<int>(size()), size(), r, heap);
+	std::sort_heap(heap.begin(), heap.end(), closer);
+	return heap;
+}
+
+double stateIndex::fiberDistance(const state &s, int fiber) const {
+	// a fiber has a handful of states, scanning them beats any tree search
+	double best = 1e10;
+	for (size_t i = 0; i < slotsOf[fiber].size(); i++) {
+		best = std::min(best, se3Distance(s, states[slotsOf[fiber][i]]));
+	}
+	return best;
+}
+
+std::vector<state> stateIndex::closestStates(int f1, int f2) const {
+	// all pairs of the two fibers, as in se3metrics
+	state sf1, sf2;
+	double mindist = 1e10;
+	for (size_t i = 0; i < slotsOf[f1].size(); i++) {
+		state a = states[slotsOf[f1][i]];
+		for (size_t j = 0; j < slotsOf[f2].size(); j++) {
+			state b = states[slotsOf[f2][j]];
+			double d = se3Distance(a, b);
+			if (d < mindist) {
+				mindist = d;
+				sf1 = a;
+				sf2 = b;
+			}
+		}
+	}
+	std::vector<state> closest;
+	closest.push_back(sf1);
+	closest.push_back(sf2);
+	return closest;
+}
+
+template<typename T>
+static void writeVector(std::ofstream &out, const std::vector<T> &v) {
+	long long n = v.size();
+	out.write(reinterpret_cast<const char *>(&n), sizeof(n));
+	if (n > 0) {
+		out.write(reinterpret_cast<const char *>(&v[0]), n * sizeof(T));
+	}
+}
+
+template<typename T>
+static bool readVector(std::ifstream &in, std::vector<T> &v) {
+	long long n = 0;
+	if (!in.read(reinterpret_cast<char *>(&n), sizeof(n)) || n < 0) {
+		return false;
+	}
+	v.resize(n);
+	return n == 0 || bool(in.read(reinterpret_cast<char *>(&v[0]), n * sizeof(T)));
+}
+
+bool stateIndex::write(const std::string &path) const {
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if (!out) {
+		std::cout << "cannot write state index " << path << std::endl;
+		return false;
+	}
+	out.write("IMSI", 4);
+	out.write(reinterpret_cast<const char *>(&STATE_INDEX_VERSION),
+			sizeof(STATE_INDEX_VERSION));
+	writeVector(out, states.x);
+	writeVector(out, states.y);
+	writeVector(out, states.z);
+	writeVector(out, states.qx);
+	writeVector(out, states.qy);
+	writeVector(out, states.qz);
+	writeVector(out, states.qw);
+	writeVector(out, fiberOf);
+	writeVector(out, indexOf);
+	writeVector(out, radius);
+	return bool(out);
+}
+
+bool stateIndex::read(const std::string &path) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	char magic[4];
+	int version = 0;
+	if (!in.read(magic, 4) || std::string(magic, 4) != "IMSI"
+			|| !in.read(reinterpret_cast<char *>(&version), sizeof(version))
+			|| version != STATE_INDEX_VERSION) {
+		std::cout << "not a state index " << path << std::endl;
+		return false;
+	}
+	bool ok = readVector(in, states.x) && readVector(in, states.y)
+			&& readVector(in, states.z) && readVector(in, states.qx)
+			&& readVector(in, states.qy) && readVector(in, states.qz)
+			&& readVector(in, states.qw) && readVector(in, fiberOf)
+			&& readVector(in, indexOf) && readVector(in, radius);
+	size_t n = fiberOf.size();
+	if (!ok || states.size() != n || indexOf.size() != n || radius.size() != n) {
+		std::cout << "truncated state index " << path << std::endl;
+		return false;
+	}
+	slotsOf.clear();
+	for (size_t i = 0; i < n; i++) {
+		if (fiberOf[i] >= static_cast<int>(slotsOf.size())) {
+			slotsOf.resize(fiberOf[i] + 1);
+		}
+		std::vector<int> &slots = slotsOf[fiberOf[i]];
+		if (indexOf[i] >= static_cast<int>(slots.size())) {
+			slots.resize(indexOf[i] + 1);
+		}
+		slots[indexOf[i]] = static_cast<int>(i);
+	}
+	return true;
+}
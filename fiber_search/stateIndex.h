@@ -0,0 +1,72 @@
+/*
+ * stateIndex.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef STATEINDEX_H_
+#define STATEINDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "state.h"
+#include "se3kernel.h"
+
+struct stateHit {
+	double distance;
+	int fiber; // fiber of the state
+	int index; // position of the state in its fiber
+};
+
+class stateIndex {
+	/*
+	 * Vantage point tree over every state of a set of fibers, answering
+	 * queries in the Riemannian SE(3) distance. That distance is not a
+	 * metric, so the tree is built on se3ProductDistance, a metric below
+	 * it: a subtree is skipped when its product distance to the query
+	 * already exceeds the k-th Riemannian distance found, and results are
+	 * exact. The tree is implicit: the states are permuted so that a
+	 * subrange [lo, hi) has its vantage point at lo, the states no farther
+	 * than radius[lo] from it in [lo + 1, mid) and the others in [mid, hi).
+	 * The top of the tree is built in parallel and the whole index is a few
+	 * flat arrays, written and read as they are.
+	 */
+public:
+	stateIndex() {
+	}
+	explicit stateIndex(const std::vector<fiber> &fibers);
+
+	size_t size() const {
+		return fiberOf.size();
+	}
+
+	// the k closest states, nearest first
+	std::vector<stateHit> nearest(const state &s, int k) const;
+	// all states within radius, nearest first
+	std::vector<stateHit> within(const state &s, double radius) const;
+
+	// stateFiberDistance and closestStates on the indexed states. These
+	// scan the states of the fibers directly: a search restricted to one
+	// fiber cannot prune before it has found a state of that fiber.
+	double fiberDistance(const state &s, int fiber) const;
+	std::vector<state> closestStates(int f1, int f2) const;
+
+	// binary file of the flat arrays, false if it cannot be written / read
+	bool write(const std::string &path) const;
+	bool read(const std::string &path);
+
+private:
+	void build(int lo, int hi);
+	void search(const state &s, int lo, int hi, size_t k, double radius,
+			std::vector<stateHit> &heap) const;
+	stateHit hit(int slot, double distance) const;
+
+	stateArray states;          // in tree order
+	std::vector<int> fiberOf;   // fiber of every slot
+	std::vector<int> indexOf;   // position in the fiber of every slot
+	std::vector<double> radius; // vantage point radius (product metric)
+	std::vector<std::vector<int> > slotsOf; // slot of every state of a fiber
+};
+
+#endif /* STATEINDEX_H_ */
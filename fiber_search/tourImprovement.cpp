@@ -0,0 +1,436 @@
+/*
+ * tourImprovement.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <omp.h>
+
+#include "tourImprovement.h"
+#include "pointIndex.h"
+
+using namespace std;
+
+// candidate neighbours per fiber, the lightest edges of its graph row
+static const int TOUR_NEIGHBOURS = 8;
+// longest segment an Or-opt move relocates
+static const int OR_SEGMENT = 3;
+// positions spanned by a double bridge kick
+static const int KICK_SPAN = 50;
+// moves must shorten the tour by more than this
+static const double GAIN_EPSILON = 1e-9;
+
+class tourSearch {
+	/*
+	 * A cycle over n fibers as an array and the position of every fiber in
+	 * it. Moves are phrased as edge exchanges, so they do not depend on
+	 * which way round the array holds the cycle: a 2-opt reversal turns
+	 * the shorter side of the cycle. Changes since the last commit() are
+	 * journaled, so a kick that did not pay off is undone in the time it
+	 * took.
+	 */
+public:
+	tourSearch(const fiberSet &fibers,
+			const std::vector<std::vector<int> > &neighbours,
+			const std::vector<int> &cycle) :
+			fibers(fibers), neighbours(neighbours), n(
+					static_cast<int>(cycle.size())), tour(cycle), pos(n), queued(
+					n, false), kickStart(-1) {
+		for (int i = 0; i < n; i++) {
+			pos[tour[i]] = i;
+		}
+		len = 0.0;
+		for (int i = 0; i < n; i++) {
+			len += d(tour[i], tour[(i + 1) % n]);
+		}
+		committed = len;
+	}
+
+	const std::vector<int> &cycle() const {
+		return tour;
+	}
+	double length() const {
+		return len;
+	}
+
+	// keep the changes since the last commit
+	void commit() {
+		journal.clear();
+		kickStart = -1;
+		committed = len;
+	}
+	// undo them
+	void rollback() {
+		for (size_t k = journal.size(); k-- > 0;) {
+			reverse(journal[k].first, journal[k].second, false);
+		}
+		if (kickStart >= 0) {
+			for (size_t k = 0; k < kicked.size(); k++) {
+				int p = (kickStart + static_cast<int>(k)) % n;
+				tour[p] = kicked[k];
+				pos[kicked[k]] = p;
+			}
+		}
+		for (size_t k = 0; k < active.size(); k++) {
+			queued[active[k]] = false;
+		}
+		active.clear();
+		len = committed;
+		commit();
+	}
+
+	void activateAll() {
+		for (int i = 0; i < n; i++) {
+			activate(tour[i]);
+		}
+	}
+
+	// search until no fiber has a move or the deadline passes, false if
+	// stopped by the deadline
+	bool optimise(double deadline) {
+		for (long steps = 0; !active.empty(); steps++) {
+			if ((steps & 63) == 0 && omp_get_wtime() > deadline) {
+				return false;
+			}
+			int a = active.back();
+			active.pop_back();
+			queued[a] = false;
+			if (twoOpt(a) || orOpt(a)) {
+				activate(a);
+			}
+		}
+		return true;
+	}
+
+	// double bridge on a stretch of the cycle: A B C D -> A C B D, only
+	// right after a commit
+	void kick(std::mt19937 &rng) {
+		int span = std::min(KICK_SPAN, n - 1);
+		int i = std::uniform_int_distribution<int>(0, n - 1)(rng);
+		int c[3];
+		for (int k = 0; k < 3; k++) {
+			c[k] = std::uniform_int_distribution<int>(1, span - 1)(rng);
+		}
+		std::sort(c, c + 3);
+		if (c[0] == c[1] || c[1] == c[2]) {
+			return;
+		}
+		std::vector<int> seg(span);
+		for (int k = 0; k < span; k++) {
+			seg[k] = tour[(i + k) % n];
+		}
+		// seg = A [c0, c1) B [c1, c2) C [c2, span) D
+		kickStart = i;
+		kicked = seg;
+		std::vector<int> moved(seg.begin(), seg.begin() + c[0]);
+		moved.insert(moved.end(), seg.begin() + c[1], seg.begin() + c[2]);
+		moved.insert(moved.end(), seg.begin() + c[0], seg.begin() + c[1]);
+		moved.insert(moved.end(), seg.begin() + c[2], seg.end());
+		for (int k = 0; k + 1 < span; k++) {
+			len += d(moved[k], moved[k + 1]) - d(seg[k], seg[k + 1]);
+		}
+		for (int k = 0; k < span; k++) {
+			int p = (i + k) % n;
+			tour[p] = moved[k];
+			pos[moved[k]] = p;
+		}
+		for (int k = 0; k < 3; k++) {
+			activate(seg[c[k] - 1]);
+			activate(seg[c[k]]);
+		}
+	}
+
+private:
+	double d(int a, int b) const {
+		return fibers.distance(a, b);
+	}
+	int succ(int a) const {
+		return tour[pos[a] + 1 == n ? 0 : pos[a] + 1];
+	}
+	int pred(int a) const {
+		return tour[pos[a] == 0 ? n - 1 : pos[a] - 1];
+	}
+	void activate(int a) {
+		if (!queued[a]) {
+			queued[a] = true;
+			active.push_back(a);
+		}
+	}
+
+	void reverse(int from, int to, bool record = true) {
+		// reverse the path from..to (following succ), or the rest of the
+		// cycle if that is shorter; both give the same cycle. The journal
+		// keeps the call that undoes it: the path now reads to..from, or
+		// from..to if the rest was turned
+		int i = pos[from], j = pos[to];
+		int count = (j - i + n) % n + 1;
+		bool rest = 2 * count > n;
+		if (record) {
+			journal.push_back(rest ? std::make_pair(from, to)
+					: std::make_pair(to, from));
+		}
+		if (rest) {
+			i = pos[succ(to)];
+			j = pos[pred(from)];
+			count = n - count;
+		}
+		for (int k = 0; k < count / 2; k++) {
+			int a = tour[i], b = tour[j];
+			tour[i] = b;
+			pos[b] = i;
+			tour[j] = a;
+			pos[a] = j;
+			i = (i + 1 == n) ? 0 : i + 1;
+			j = (j == 0) ? n - 1 : j - 1;
+		}
+	}
+
+	void exchange(int a, int b, int c, int e) {
+		// replace the tour edges (a, b), (c, e) by (a, c), (b, e); b and e
+		// follow a and c in the same direction
+		if (succ(a) == b) {
+			reverse(b, c);
+		} else {
+			reverse(a, e);
+		}
+		activate(a);
+		activate(b);
+		activate(c);
+		activate(e);
+	}
+
+	bool twoOpt(int a) {
+		for (int dir = 0; dir < 2; dir++) {
+			int b = dir == 0 ? succ(a) : pred(a);
+			double dab = d(a, b);
+			const std::vector<int> &near = neighbours[a];
+			for (size_t k = 0; k < near.size(); k++) {
+				int c = near[k];
+				double dac = d(a, c);
+				if (dac >= dab) {
+					break;
+				}
+				int e = dir == 0 ? succ(c) : pred(c);
+				if (c == b || e == a) {
+					continue;
+				}
+				double delta = dac + d(b, e) - dab - d(c, e);
+				if (delta < -GAIN_EPSILON) {
+					exchange(a, b, c, e);
+					len += delta;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	bool orOpt(int s1) {
+		// the segment s1 .. sL (following succ) between p and nx
+		int sL = s1;
+		for (int count = 1; count <= OR_SEGMENT && count + 3 <= n; count++) {
+			if (count > 1) {
+				sL = succ(sL);
+			}
+			int p = pred(s1), nx = succ(sL);
+			double removal = d(p, s1) + d(sL, nx) - d(p, nx);
+			if (removal <= GAIN_EPSILON) {
+				continue;
+			}
+			for (int end = 0; end < 2; end++) {
+				int x = end == 0 ? s1 : sL;
+				const std::vector<int> &near = neighbours[x];
+				for (size_t k = 0; k < near.size(); k++) {
+					int c = near[k];
+					double dxc = d(x, c);
+					if (dxc >= removal) {
+						break;
+					}
+					if (inSegment(c, s1, count)) {
+						continue;
+					}
+					// x joins c from either side: the gap (c, succ c) or
+					// (pred c, c), the orientation of the segment follows
+					for (int side = 0; side < 2; side++) {
+						int u = side == 0 ? c : pred(c);
+						int v = side == 0 ? succ(c) : c;
+						if (u == p || u == nx || v == p || v == nx
+								|| inSegment(u, s1, count)
+								|| inSegment(v, s1, count)) {
+							continue;
+						}
+						// forward: u s1 .. sL v
+						bool forward = (x == s1) == (side == 0);
+						double insert = forward ?
+								d(u, s1) + d(sL, v) : d(u, sL) + d(s1, v);
+						double delta = insert - d(u, v) - removal;
+						if (delta < -GAIN_EPSILON) {
+							moveSegment(s1, sL, p, nx, u, v, forward);
+							len += delta;
+							return true;
+						}
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	bool inSegment(int c, int s1, int count) const {
+		return (pos[c] - pos[s1] + n) % n < count;
+	}
+
+	void moveSegment(int s1, int sL, int p, int nx, int u, int v,
+			bool forward) {
+		// p s1..sL nx .. u v  ->  p nx .. u sL..s1 v  (two exchanges), a
+		// third turns the segment round for forward insertion
+		exchange(p, s1, u, v);
+		exchange(p, u, nx, sL);
+		if (forward) {
+			exchange(u, sL, s1, v);
+		}
+	}
+
+	const fiberSet &fibers;
+	const std::vector<std::vector<int> > &neighbours;
+	int n;
+	std::vector<int> tour;
+	std::vector<int> pos;
+	std::vector<int> active;
+	std::vector<bool> queued;
+	double len, committed;
+	// reversals and the kicked stretch since the last commit
+	std::vector<std::pair<int, int> > journal;
+	int kickStart;
+	std::vector<int> kicked;
+};
+
+double tourLength(const std::vector<unsigned int> &tour,
+		const fiberSet &fibers) {
+	double len = 0.0;
+	for (size_t i = 0; i + 1 < tour.size(); i++) {
+		len += fibers.distance(tour[i], tour[i + 1]);
+	}
+	return len;
+}
+
+static void keepClosest(std::vector<std::pair<double, int> > &row,
+		std::vector<int> &near) {
+	size_t keep = std::min(row.size(), static_cast<size_t>(TOUR_NEIGHBOURS));
+	std::partial_sort(row.begin(), row.begin() + keep, row.end());
+	for (size_t k = 0; k < keep; k++) {
+		near.push_back(row[k].second);
+	}
+}
+
+static std::vector<unsigned int> searchTour(
+		const std::vector<unsigned int> &tour,
+		const std::vector<std::vector<int> > &neighbours,
+		const fiberSet &fibers, double seconds) {
+	int n = static_cast<int>(neighbours.size());
+	double before = tourLength(tour, fibers);
+	double start = omp_get_wtime();
+	double deadline = start + seconds;
+	std::vector<int> initial(tour.begin(), tour.end() - 1);
+	std::vector<int> best = initial;
+	double bestLength = before;
+	long totalKicks = 0;
+
+#pragma omp parallel
+	{
+		// thread 0 improves the tour itself, the others start from a
+		// scrambled copy so the threads explore different tours
+		int thread = omp_get_thread_num();
+		std::mt19937 rng(7919 * (thread + 1));
+		tourSearch search(fibers, neighbours, initial);
+		if (thread > 0) {
+			for (int k = 0; k < n / 8; k++) {
+				search.kick(rng);
+			}
+		}
+		search.activateAll();
+		search.optimise(deadline);
+		search.commit();
+		long kicks = 0;
+		while (omp_get_wtime() < deadline) {
+			double last = search.length();
+			search.kick(rng);
+			if (search.optimise(deadline)
+					&& search.length() < last - GAIN_EPSILON) {
+				search.commit();
+			} else {
+				search.rollback();
+			}
+			kicks++;
+		}
+#pragma omp critical
+		{
+			totalKicks += kicks;
+			if (search.length() < bestLength) {
+				best = search.cycle();
+				bestLength = search.length();
+			}
+		}
+	}
+
+	// closed again, from fiber 0
+	std::vector<unsigned int> path;
+	int zero = static_cast<int>(std::find(best.begin(), best.end(), 0)
+			- best.begin());
+	for (int i = 0; i <= n; i++) {
+		path.push_back(best[(zero + i) % n]);
+	}
+	cout << "tour length " << before << " improved to " << bestLength
+			<< " (" << totalKicks << " kicks, " << omp_get_wtime() - start
+			<< " s)" << endl;
+	return path;
+}
+
+std::vector<unsigned int> improveTour(const std::vector<unsigned int> &tour,
+		const csrGraph &g, const fiberSet &fibers, double seconds) {
+	int n = g.n;
+	if (n < 8 || tour.size() != static_cast<size_t>(n) + 1) {
+		return tour;
+	}
+
+	// neighbour lists, the lightest edges of every row
+	std::vector<std::vector<int> > neighbours(n);
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int u = 0; u < n; u++) {
+		std::vector<std::pair<double, int> > row;
+		for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; i++) {
+			row.push_back(std::make_pair(g.weights[i], g.targets[i]));
+		}
+		keepClosest(row, neighbours[u]);
+	}
+	return searchTour(tour, neighbours, fibers, seconds);
+}
+
+std::vector<unsigned int> improveTour(const std::vector<unsigned int> &tour,
+		const fiberSet &fibers, double seconds) {
+	int n = static_cast<int>(fibers.size());
+	if (n < 8 || tour.size() != static_cast<size_t>(n) + 1) {
+		return tour;
+	}
+
+	// neighbour lists, the closest of the nearest fibers by position
+	pointIndex index(fibers.positions());
+	int candidates = std::min(n, 2 * TOUR_NEIGHBOURS + 1);
+	std::vector<std::vector<int> > neighbours(n);
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int u = 0; u < n; u++) {
+		std::vector<int> near = index.nearest(fibers.positionOf(u), candidates);
+		std::vector<std::pair<double, int> > row;
+		for (size_t c = 0; c < near.size(); c++) {
+			if (near[c] != u) {
+				row.push_back(std::make_pair(fibers.distance(u, near[c]),
+						near[c]));
+			}
+		}
+		keepClosest(row, neighbours[u]);
+	}
+	return searchTour(tour, neighbours, fibers, seconds);
+}
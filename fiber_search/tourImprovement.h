@@ -0,0 +1,37 @@
+/*
+ * tourImprovement.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef TOURIMPROVEMENT_H_
+#define TOURIMPROVEMENT_H_
+
+#include <vector>
+
+#include "csrGraph.h"
+#include "fiberSet.h"
+
+/*
+ * Local search on a fiber tour from solveTSP (closed, starting and ending at
+ * fiber 0). Moves are 2-opt and Or-opt (a segment of one to three fibers
+ * moved elsewhere, in either orientation), tried only towards the lightest
+ * graph neighbours of a fiber and only for fibers whose tour edges changed
+ * since they were last looked at (don't-look bits). Every thread runs its
+ * own iterated local search, kicking its best tour with a double bridge and
+ * searching again, until the time budget (seconds) runs out; the best tour
+ * over all threads is returned in the same closed form. The budget starts
+ * once the candidate lists are built.
+ */
+std::vector<unsigned int> improveTour(const std::vector<unsigned int> &tour,
+		const csrGraph &g, const fiberSet &fibers, double seconds);
+// the same without a graph, the candidates are the closest (by fiber
+// distance) of the nearest fibers by position
+std::vector<unsigned int> improveTour(const std::vector<unsigned int> &tour,
+		const fiberSet &fibers, double seconds);
+
+// length of a closed tour in fiber distance
+double tourLength(const std::vector<unsigned int> &tour,
+		const fiberSet &fibers);
+
+#endif /* TOURIMPROVEMENT_H_ */
@@ -0,0 +1,105 @@
+/*
+ * adaptiveSweep.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <iostream>
+#include <assert.h>
+
+#include "adaptiveSweep.h"
+
+using namespace std;
+
+orientationHierarchy::orientationHierarchy(int dimension) :
+        dimension(dimension) {
+    assert(dimension == 2 || dimension == 3);
+}
+
+int orientationHierarchy::levelSize(int level) const {
+    if (dimension == 2)
+        return 6 * (1 << level);
+    return 72 * (1 << (3 * level));
+}
+
+std::vector<int> orientationHierarchy::children(int level, int index) const {
+    if (dimension == 2) {
+        std::vector<int> c;
+        c.push_back(2 * index);
+        c.push_back(2 * index + 1);
+        return c;
+    }
+    return so3Children(level, index);
+}
+
+double orientationHierarchy::angle(int level, int index) const {
+    // the S^1 grid angles, (index + 1/2) * 2pi / (6*2^level)
+    assert(dimension == 2);
+    return (index + 0.5) * 2 * M_PI / levelSize(level);
+}
+
+Eigen::Matrix3d orientationHierarchy::rotation(int level, int index) {
+    if (dimension == 2) {
+        return Eigen::AngleAxisd(angle(level, index), Eigen::Vector3d::UnitZ()).toRotationMatrix();
+    }
+    while (static_cast<int>(so3Levels.size()) <= level) {
+        so3Levels.push_back(simpleSO3Grid(static_cast<int>(so3Levels.size())));
+    }
+    return so3Levels[level].rotation(index);
+}
+
+adaptiveSweepResult adaptiveSweep(orientationHierarchy &hierarchy,
+        int coarseLevel, int maxLevel,
+        std::function<af::array(int level, int index)> evaluate, af::dim4 dims,
+        af::array roi) {
+
+    adaptiveSweepResult result;
+    result.feasible = af::constant(0, dims, b8);
+    result.count = af::constant(0, dims, f32);
+    result.evaluations = 0;
+    bool restrict = !roi.isempty();
+    if (restrict) {
+        roi = roi > 0;
+    }
+
+    // the coarse level is evaluated in full
+    std::vector<int> active;
+    for (int i = 0; i < hierarchy.levelSize(coarseLevel); i++) {
+        active.push_back(i);
+    }
+
+    for (int level = coarseLevel; level <= maxLevel && !active.empty();
+            level++) {
+        std::vector<int> productive; // orientations that grew the union
+        for (size_t k = 0; k < active.size(); k++) {
+            af::array f = evaluate(level, active[k]) > 0;
+            af::array fresh = f && !result.feasible;
+            if (restrict) {
+                fresh = fresh && roi;
+            }
+            if (af::anyTrue<bool>(fresh)) {
+                productive.push_back(active[k]);
+            }
+            result.feasible = result.feasible || f;
+            result.count += f.as(f32);
+            // keep the lazy expression tree from growing across iterations
+            af::eval(result.feasible, result.count);
+        }
+        result.evaluated.push_back(active);
+        result.evaluations += static_cast<int>(active.size());
+        cout << "level " << level << ": evaluated " << active.size() << " of "
+                << hierarchy.levelSize(level) << " orientations, "
+                << productive.size() << " added new voxels" << endl;
+
+        if (level > coarseLevel && productive.empty()) {
+            break; // refinement no longer changes the union
+        }
+        // refine only where new feasibility appeared
+        active.clear();
+        for (size_t k = 0; k < productive.size(); k++) {
+            std::vector<int> c = hierarchy.children(level, productive[k]);
+            active.insert(active.end(), c.begin(), c.end());
+        }
+    }
+    return result;
+}
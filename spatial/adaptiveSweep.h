@@ -0,0 +1,59 @@
+/*
+ * adaptiveSweep.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef ADAPTIVESWEEP_H_
+#define ADAPTIVESWEEP_H_
+
+#include <functional>
+#include <vector>
+#include <arrayfire.h>
+#include <Eigen/Geometry>
+#include <Eigen/Dense>
+
+#include "so3Grid.h"
+
+class orientationHierarchy {
+    /*
+     * Hierarchical orientation grid: S^1 for 2d problems (6*2^l angles at
+     * level l) and the ISOI SO(3) grid for 3d problems (72*8^l rotations).
+     * Each orientation has 2 (resp. 8) children at the next level. Levels
+     * are generated on first use.
+     */
+public:
+    orientationHierarchy(int dimension);
+    int levelSize(int level) const;
+    std::vector<int> children(int level, int index) const;
+    // rotation of an orientation, about z for 2d problems
+    Eigen::Matrix3d rotation(int level, int index);
+    // angle of an orientation in radians (2d problems only)
+    double angle(int level, int index) const;
+
+private:
+    int dimension;
+    std::vector<so3Grid> so3Levels;
+};
+
+struct adaptiveSweepResult {
+    af::array feasible; // union of the indicators of all evaluated orientations
+    af::array count;    // number of evaluated orientations covering each voxel
+    // indices of the orientations evaluated at each level, from coarseLevel on
+    std::vector<std::vector<int> > evaluated;
+    int evaluations;
+};
+
+/*
+ * Adaptive orientation sweep. All orientations of coarseLevel are evaluated;
+ * then only the children of orientations that added new voxels to the union
+ * (inside roi, if roi is not empty) are evaluated at the next level. The
+ * sweep stops when a level adds nothing to the union or maxLevel is done.
+ * evaluate(level, index) returns the indicator of one orientation.
+ */
+adaptiveSweepResult adaptiveSweep(orientationHierarchy &hierarchy,
+        int coarseLevel, int maxLevel,
+        std::function<af::array(int level, int index)> evaluate, af::dim4 dims,
+        af::array roi = af::array());
+
+#endif /* ADAPTIVESWEEP_H_ */
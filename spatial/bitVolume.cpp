@@ -0,0 +1,117 @@
+/*
+ * bitVolume.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <assert.h>
+
+#include "bitVolume.h"
+
+bitVolume::bitVolume() :
+        shape(0, 1, 1, 1), n(0) {
+}
+
+bitVolume::bitVolume(af::dim4 dims) :
+        shape(dims), n(static_cast<long>(dims.elements())), words((n + 63) / 64,
+                0) {
+}
+
+bitVolume::bitVolume(const af::array &x) :
+        shape(x.dims()), n(static_cast<long>(x.elements())), words((n + 63) / 64,
+                0) {
+    if (n == 0)
+        return;
+    // one byte per voxel on the way over, packed on the host
+    af::array support = (x > 0).as(u8);
+    std::vector<unsigned char> bytes(n);
+    support.host(&bytes[0]);
+    pack(&bytes[0]);
+}
+
+bitVolume::bitVolume(af::dim4 dims, const std::vector<unsigned char> &bytes) :
+        shape(dims), n(static_cast<long>(dims.elements())), words((n + 63) / 64,
+                0) {
+    assert(static_cast<long>(bytes.size()) == n);
+    if (n > 0)
+        pack(&bytes[0]);
+}
+
+void bitVolume::pack(const unsigned char *bytes) {
+    long nwords = static_cast<long>(words.size());
+#pragma omp parallel for
+    for (long w = 0; w < nwords; w++) {
+        long first = w * 64;
+        long last = std::min(first + 64, n);
+        uint64_t word = 0;
+        for (long i = first; i < last; i++)
+            word |= uint64_t(bytes[i] != 0) << (i - first);
+        words[w] = word;
+    }
+}
+
+long bitVolume::count() const {
+    long c = 0;
+    long nwords = static_cast<long>(words.size());
+#pragma omp parallel for reduction(+:c)
+    for (long w = 0; w < nwords; w++)
+        c += __builtin_popcountll(words[w]);
+    return c;
+}
+
+long bitVolume::countAndNot(const bitVolume &other) const {
+    assert(n == other.n);
+    long c = 0;
+    long nwords = static_cast<long>(words.size());
+#pragma omp parallel for reduction(+:c)
+    for (long w = 0; w < nwords; w++)
+        c += __builtin_popcountll(words[w] & ~other.words[w]);
+    return c;
+}
+
+long bitVolume::countAnd(const bitVolume &other) const {
+    assert(n == other.n);
+    long c = 0;
+    long nwords = static_cast<long>(words.size());
+#pragma omp parallel for reduction(+:c)
+    for (long w = 0; w < nwords; w++)
+        c += __builtin_popcountll(words[w] & other.words[w]);
+    return c;
+}
+
+bitVolume &bitVolume::operator|=(const bitVolume &other) {
+    assert(n == other.n);
+    for (size_t w = 0; w < words.size(); w++)
+        words[w] |= other.words[w];
+    return *this;
+}
+
+bitVolume &bitVolume::operator&=(const bitVolume &other) {
+    assert(n == other.n);
+    for (size_t w = 0; w < words.size(); w++)
+        words[w] &= other.words[w];
+    return *this;
+}
+
+bitVolume &bitVolume::andNot(const bitVolume &other) {
+    assert(n == other.n);
+    for (size_t w = 0; w < words.size(); w++)
+        words[w] &= ~other.words[w];
+    return *this;
+}
+
+void bitVolume::unpack(std::vector<unsigned char> &bytes) const {
+    bytes.resize(n);
+#pragma omp parallel for
+    for (long i = 0; i < n; i++)
+        bytes[i] = test(i);
+}
+
+af::array bitVolume::toArray() const {
+    if (n == 0)
+        return af::array();
+    std::vector<unsigned char> bytes;
+    unpack(bytes);
+    return af::array(shape, &bytes[0]).as(b8);
+}
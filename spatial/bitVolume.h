@@ -0,0 +1,72 @@
+/*
+ * bitVolume.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef BITVOLUME_H_
+#define BITVOLUME_H_
+
+#include <stdint.h>
+#include <vector>
+#include <arrayfire.h>
+
+class bitVolume {
+    /*
+     * Host side indicator set packed 64 voxels to a word, in arrayfire
+     * (column major) voxel order. Set operations and counts run a word at a
+     * time, which is what the orientation sweeps need to track coverage
+     * without a device round trip per query.
+     */
+public:
+    bitVolume();
+    explicit bitVolume(af::dim4 dims);
+    // pack the support (x > 0) of an array
+    explicit bitVolume(const af::array &x);
+    // pack one byte per voxel (nonzero is set)
+    bitVolume(af::dim4 dims, const std::vector<unsigned char> &bytes);
+
+    af::dim4 dims() const {
+        return shape;
+    }
+    long size() const {
+        return n;
+    }
+    bool empty() const {
+        return n == 0;
+    }
+    bool test(long i) const {
+        return (words[i >> 6] >> (i & 63)) & 1;
+    }
+    void set(long i) {
+        words[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+    const std::vector<uint64_t> &data() const {
+        return words;
+    }
+
+    // number of set voxels
+    long count() const;
+    // number of voxels set here and not in other, |this \ other|
+    long countAndNot(const bitVolume &other) const;
+    // number of voxels set in both, |this & other|
+    long countAnd(const bitVolume &other) const;
+
+    bitVolume &operator|=(const bitVolume &other);
+    bitVolume &operator&=(const bitVolume &other);
+    // this \ other
+    bitVolume &andNot(const bitVolume &other);
+
+    // unpack to a b8 array
+    af::array toArray() const;
+    // unpack to one byte (0 or 1) per voxel
+    void unpack(std::vector<unsigned char> &bytes) const;
+
+private:
+    void pack(const unsigned char *bytes);
+    af::dim4 shape;
+    long n;
+    std::vector<uint64_t> words;
+};
+
+#endif /* BITVOLUME_H_ */
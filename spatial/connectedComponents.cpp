@@ -0,0 +1,269 @@
+/*
+ * connectedComponents.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+#include <unordered_map>
+#include <omp.h>
+
+#include "connectedComponents.h"
+
+using namespace std;
+
+struct run {
+    int x0, x1; // inclusive range along dim 0
+};
+
+static long nextBit(const std::vector<uint64_t> &words, long p, long end,
+        bool value) {
+    // first position >= p (and < end) holding value, end if there is none.
+    // Whole words without a match are skipped.
+    while (p < end) {
+        uint64_t w = words[p >> 6];
+        if (!value)
+            w = ~w;
+        w >>= (p & 63);
+        if (w != 0)
+            return std::min(end, p + __builtin_ctzll(w));
+        p = (p | 63) + 1;
+    }
+    return end;
+}
+
+static unsigned findRoot(std::vector<unsigned> &parent, unsigned i) {
+    // path halving
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void unite(std::vector<unsigned> &parent, unsigned a, unsigned b) {
+    // the smaller id becomes the root, so roots come first in raster order
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+static void joinRows(std::vector<unsigned> &parent,
+        const std::vector<run> &runs, const std::vector<long> &rowStart,
+        long r, long q, int expand) {
+    // join the runs of row r with the overlapping runs of row q, runs of q
+    // are widened by expand voxels on each side (diagonal neighbours)
+    long i = rowStart[r], iend = rowStart[r + 1];
+    long j = rowStart[q], jend = rowStart[q + 1];
+    while (i < iend && j < jend) {
+        if (runs[j].x1 + expand < runs[i].x0) {
+            j++;
+        } else if (runs[i].x1 < runs[j].x0 - expand) {
+            i++;
+        } else {
+            unite(parent, static_cast<unsigned>(i), static_cast<unsigned>(j));
+            // advance whichever run ends first
+            if (runs[i].x1 < runs[j].x1)
+                i++;
+            else
+                j++;
+        }
+    }
+}
+
+labelledVolume labelComponents(const bitVolume &x, int connectivity) {
+    af::dim4 dims = x.dims();
+    int n0 = static_cast<int>(dims[0]);
+    int n1 = static_cast<int>(dims[1]);
+    int n2 = static_cast<int>(dims[2]);
+    bool volume = n2 > 1;
+
+    // widening of the runs in the neighbouring rows; (i1-1, i2), (i1, i2-1)
+    // and the two diagonal rows (i1-1, i2-1), (i1+1, i2-1), -1 is no join
+    int e1, e2 = -1, eDiag = -1;
+    switch (connectivity) {
+    case 4:
+        e1 = 0;
+        break;
+    case 8:
+        e1 = 1;
+        break;
+    case 6:
+        e1 = 0, e2 = 0;
+        break;
+    case 18:
+        e1 = 1, e2 = 1, eDiag = 0;
+        break;
+    case 26:
+        e1 = 1, e2 = 1, eDiag = 1;
+        break;
+    default:
+        cout << "Unsupported connectivity " << connectivity << endl;
+        exit(1);
+    }
+    if (volume != (connectivity == 6 || connectivity == 18
+            || connectivity == 26)) {
+        cout << "Connectivity " << connectivity << " does not match a "
+                << (volume ? "3d" : "2d") << " volume" << endl;
+        exit(1);
+    }
+
+    const std::vector<uint64_t> &words = x.data();
+    long nrows = static_cast<long>(n1) * n2;
+
+    // 1. runs of every row, counted then filled
+    std::vector<long> rowStart(nrows + 1, 0);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long r = 0; r < nrows; r++) {
+        long start = r * n0, end = start + n0, count = 0;
+        for (long p = nextBit(words, start, end, true); p < end;) {
+            p = nextBit(words, nextBit(words, p, end, false), end, true);
+            count++;
+        }
+        rowStart[r + 1] = count;
+    }
+    for (long r = 0; r < nrows; r++)
+        rowStart[r + 1] += rowStart[r];
+    long nruns = rowStart[nrows];
+    if (nruns >= 0xffffffffL) {
+        cout << "Too many runs to label: " << nruns << endl;
+        exit(1);
+    }
+    std::vector<run> runs(nruns);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long r = 0; r < nrows; r++) {
+        long start = r * n0, end = start + n0, k = rowStart[r];
+        for (long p = nextBit(words, start, end, true); p < end;) {
+            long q = nextBit(words, p, end, false);
+            runs[k].x0 = static_cast<int>(p - start);
+            runs[k].x1 = static_cast<int>(q - start - 1);
+            k++;
+            p = nextBit(words, q, end, true);
+        }
+    }
+
+    std::vector<unsigned> parent(nruns);
+    for (long i = 0; i < nruns; i++)
+        parent[i] = static_cast<unsigned>(i);
+
+    // rows only join rows of the same plane or the previous plane; a plane
+    // is a slice of dim 2 for volumes and a single row for images
+    long planeRows = volume ? n1 : 1;
+    long nplanes = nrows / planeRows;
+    int nthreads = omp_get_max_threads();
+    int nslabs = static_cast<int>(std::min<long>(nthreads, nplanes));
+    std::vector<long> slabStart(nslabs + 1);
+    for (int s = 0; s <= nslabs; s++)
+        slabStart[s] = nplanes * s / nslabs;
+
+    // joins of row r, the previous plane only if withPrevious
+    auto joinRow = [&](long r, bool withSame, bool withPrevious) {
+        long i1 = volume ? r % n1 : r;
+        if (volume) {
+            if (withSame && i1 > 0)
+                joinRows(parent, runs, rowStart, r, r - 1, e1);
+            if (withPrevious && r >= n1) {
+                joinRows(parent, runs, rowStart, r, r - n1, e2);
+                if (eDiag >= 0 && i1 > 0)
+                    joinRows(parent, runs, rowStart, r, r - n1 - 1, eDiag);
+                if (eDiag >= 0 && i1 < n1 - 1)
+                    joinRows(parent, runs, rowStart, r, r - n1 + 1, eDiag);
+            }
+        } else if (withPrevious && r > 0) {
+            joinRows(parent, runs, rowStart, r, r - 1, e1);
+        }
+    };
+
+    // 2. union-find inside each slab; slabs own disjoint ranges of runs so
+    // the threads never touch the same parent entries
+#pragma omp parallel for schedule(static, 1)
+    for (int s = 0; s < nslabs; s++) {
+        for (long plane = slabStart[s]; plane < slabStart[s + 1]; plane++) {
+            bool withPrevious = plane > slabStart[s];
+            for (long r = plane * planeRows; r < (plane + 1) * planeRows; r++)
+                joinRow(r, true, withPrevious);
+        }
+    }
+    // 3. join across slab boundaries
+    for (int s = 1; s < nslabs; s++) {
+        long plane = slabStart[s];
+        for (long r = plane * planeRows; r < (plane + 1) * planeRows; r++)
+            joinRow(r, false, true);
+    }
+
+    // 4. relabel in raster order; parent[i] <= i, so the label of a
+    // parent is always known when a run is reached
+    labelledVolume result;
+    result.dims = dims;
+    std::vector<unsigned> runLabel(nruns);
+    unsigned count = 0;
+    for (long i = 0; i < nruns; i++) {
+        runLabel[i] = (parent[i] == i) ? ++count : runLabel[parent[i]];
+    }
+    result.count = static_cast<int>(count);
+    parent.clear();
+    parent.shrink_to_fit();
+
+    // 5. label volume and per label stats. Each thread keeps stats only for
+    // the labels its rows touch, so memory is bounded by the labels a thread
+    // sees rather than threads * count, and only those are merged.
+    result.labels.assign(x.size(), 0);
+    componentStats empty;
+    empty.voxels = 0;
+    for (int k = 0; k < 3; k++) {
+        empty.lo[k] = 0x7fffffff;
+        empty.hi[k] = -1;
+    }
+    result.components.assign(count, empty);
+#pragma omp parallel
+    {
+        std::unordered_map<unsigned, componentStats> local;
+        unsigned lastLabel = 0;
+        componentStats *last = NULL;
+#pragma omp for schedule(dynamic, 64)
+        for (long r = 0; r < nrows; r++) {
+            int i1 = static_cast<int>(r % n1);
+            int i2 = static_cast<int>(r / n1);
+            unsigned *row = &result.labels[r * n0];
+            for (long k = rowStart[r]; k < rowStart[r + 1]; k++) {
+                unsigned l = runLabel[k];
+                std::fill(row + runs[k].x0, row + runs[k].x1 + 1, l);
+                // neighbouring runs mostly share a label, skip the lookup
+                if (l != lastLabel) {
+                    last = &local.insert(std::make_pair(l, empty)).first->second;
+                    lastLabel = l;
+                }
+                componentStats &c = *last;
+                c.voxels += runs[k].x1 - runs[k].x0 + 1;
+                c.lo[0] = std::min(c.lo[0], runs[k].x0);
+                c.hi[0] = std::max(c.hi[0], runs[k].x1);
+                c.lo[1] = std::min(c.lo[1], i1);
+                c.hi[1] = std::max(c.hi[1], i1);
+                c.lo[2] = std::min(c.lo[2], i2);
+                c.hi[2] = std::max(c.hi[2], i2);
+            }
+        }
+#pragma omp critical
+        for (std::unordered_map<unsigned, componentStats>::const_iterator it =
+                local.begin(); it != local.end(); ++it) {
+            componentStats &c = result.components[it->first - 1];
+            c.voxels += it->second.voxels;
+            for (int k = 0; k < 3; k++) {
+                c.lo[k] = std::min(c.lo[k], it->second.lo[k]);
+                c.hi[k] = std::max(c.hi[k], it->second.hi[k]);
+            }
+        }
+    }
+    return result;
+}
+
+af::array labelledVolume::toArray() const {
+    if (labels.empty())
+        return af::array();
+    return af::array(dims, &labels[0]).as(f32);
+}
@@ -0,0 +1,44 @@
+/*
+ * connectedComponents.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef CONNECTEDCOMPONENTS_H_
+#define CONNECTEDCOMPONENTS_H_
+
+#include <vector>
+#include <arrayfire.h>
+
+#include "bitVolume.h"
+
+struct componentStats {
+    long voxels;
+    // inclusive bounding box in array axes (dim 0, dim 1, dim 2)
+    int lo[3], hi[3];
+};
+
+struct labelledVolume {
+    af::dim4 dims;
+    // 0 for background, 1..count in raster order of the first voxel
+    std::vector<unsigned> labels;
+    int count;
+    // stats of label k are components[k-1]
+    std::vector<componentStats> components;
+
+    // labels as an f32 array, like af::regions
+    af::array toArray() const;
+};
+
+/*
+ * Connected components of a 2d or 3d indicator. connectivity is 4 or 8 for
+ * 2d volumes (dims[2] == 1) and 6, 18 or 26 for 3d volumes.
+ *
+ * Block parallel union-find over runs: every row along dim 0 is split into
+ * runs of set voxels straight from the packed words, runs are joined with
+ * the runs of neighbouring rows inside each thread's slab of dim 2 (dim 1
+ * for 2d), then across slab boundaries, and finally relabelled.
+ */
+labelledVolume labelComponents(const bitVolume &x, int connectivity);
+
+#endif /* CONNECTEDCOMPONENTS_H_ */
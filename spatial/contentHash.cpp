@@ -0,0 +1,45 @@
+/*
+ * contentHash.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <stdio.h>
+#include <vector>
+
+#include "contentHash.h"
+
+uint64_t fnv1a(const void *data, size_t bytes, uint64_t h) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < bytes; i++) {
+        h ^= p[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+uint64_t hashArray(const af::array &x, uint64_t h) {
+    af::dim4 d = x.dims();
+    for (int i = 0; i < 4; i++)
+        h = hashValue(static_cast<long long>(d[i]), h);
+    h = hashValue(static_cast<int>(x.type()), h);
+    if (x.isempty())
+        return h;
+    std::vector<unsigned char> bytes(x.bytes());
+    x.host(&bytes[0]);
+    return fnv1a(&bytes[0], bytes.size(), h);
+}
+
+uint64_t hashRotation(const double *R, uint64_t h) {
+    for (int i = 0; i < 9; i++) {
+        long long q = static_cast<long long>(R[i] * 1e9 + (R[i] < 0 ? -0.5 : 0.5));
+        h = hashValue(q, h);
+    }
+    return h;
+}
+
+std::string hashString(uint64_t h) {
+    char s[17];
+    snprintf(s, sizeof(s), "%016llx", static_cast<unsigned long long>(h));
+    return std::string(s);
+}
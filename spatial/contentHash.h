@@ -0,0 +1,36 @@
+/*
+ * contentHash.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef CONTENTHASH_H_
+#define CONTENTHASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <arrayfire.h>
+
+// 64 bit FNV-1a, chained by passing the previous hash as h
+const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t fnv1a(const void *data, size_t bytes, uint64_t h = FNV_OFFSET);
+
+template<class T>
+uint64_t hashValue(const T &value, uint64_t h = FNV_OFFSET) {
+    return fnv1a(&value, sizeof(T), h);
+}
+
+// hash of the dims, type and contents of an array (one host copy)
+uint64_t hashArray(const af::array &x, uint64_t h = FNV_OFFSET);
+
+// hash of the 9 entries of a rotation matrix, entries agreeing to ~1e-9
+// hash equal
+uint64_t hashRotation(const double *R, uint64_t h = FNV_OFFSET);
+
+// 16 hex digits, used for cache file names
+std::string hashString(uint64_t h);
+
+#endif /* CONTENTHASH_H_ */
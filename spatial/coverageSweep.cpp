@@ -0,0 +1,107 @@
+/*
+ * coverageSweep.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <iostream>
+#include <queue>
+#include <utility>
+
+#include "coverageSweep.h"
+
+using namespace std;
+
+std::vector<int> greedyCoverageOrder(const std::vector<bitVolume> &estimates) {
+    // Lazy greedy: the gain of an indicator can only shrink as the union
+    // grows, so a stale gain is an upper bound and only the top of the
+    // queue has to be recomputed.
+    std::vector<int> order;
+    if (estimates.empty())
+        return order;
+    bitVolume covered(estimates[0].dims());
+    // (gain, -index) so equal gains pop in index order
+    std::priority_queue<std::pair<long, int> > queue;
+    for (size_t i = 0; i < estimates.size(); i++)
+        queue.push(std::make_pair(estimates[i].count(), -static_cast<int>(i)));
+
+    std::vector<bool> picked(estimates.size(), false);
+    while (!queue.empty()) {
+        std::pair<long, int> top = queue.top();
+        queue.pop();
+        int i = -top.second;
+        long gain = estimates[i].countAndNot(covered);
+        if (gain == 0)
+            continue; // adds nothing now, goes to the tail
+        if (!queue.empty() && gain < queue.top().first) {
+            queue.push(std::make_pair(gain, top.second)); // stale, retry later
+            continue;
+        }
+        order.push_back(i);
+        picked[i] = true;
+        covered |= estimates[i];
+    }
+    for (size_t i = 0; i < estimates.size(); i++)
+        if (!picked[i])
+            order.push_back(static_cast<int>(i));
+    return order;
+}
+
+coverageSweepResult coverageSweep(int n,
+        std::function<af::array(int index)> estimate,
+        std::function<af::array(int index)> evaluate, af::dim4 dims,
+        af::array roi, double minGain) {
+
+    coverageSweepResult result;
+    result.feasible = af::constant(0, dims, b8);
+    result.count = af::constant(0, dims, f32);
+    result.evaluations = 0;
+    result.covered = 0;
+    result.complete = false;
+
+    // order by the coarse estimates
+    std::vector<bitVolume> estimates(n);
+    for (int i = 0; i < n; i++)
+        estimates[i] = bitVolume(estimate(i));
+    result.order = greedyCoverageOrder(estimates);
+    estimates.clear();
+
+    bitVolume target = roi.isempty() ?
+            bitVolume(af::constant(1, dims, b8)) : bitVolume(roi);
+    result.roiVoxels = target.count();
+    bitVolume covered(dims);
+    long threshold = static_cast<long>(minGain * result.roiVoxels);
+
+    for (size_t k = 0; k < result.order.size(); k++) {
+        int i = result.order[k];
+        af::array f = evaluate(i) > 0;
+        result.feasible = result.feasible || f;
+        result.count += f.as(f32);
+        af::eval(result.feasible, result.count);
+        result.evaluations++;
+
+        // new roi voxels, counted on the packed copy
+        bitVolume fb(f);
+        fb &= target;
+        long gain = fb.countAndNot(covered);
+        covered |= fb;
+        result.covered += gain;
+        if (gain > 0) {
+            result.used.push_back(i);
+            result.gains.push_back(gain);
+        }
+        if (result.covered == result.roiVoxels) {
+            result.complete = true;
+            break;
+        }
+        if (minGain > 0 && gain < threshold) {
+            break; // diminishing returns
+        }
+    }
+
+    cout << "coverage sweep: evaluated " << result.evaluations << " of " << n
+            << " orientations, " << result.used.size() << " needed, covered "
+            << result.covered << " of " << result.roiVoxels << " roi voxels"
+            << endl;
+    return result;
+}
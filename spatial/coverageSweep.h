@@ -0,0 +1,49 @@
+/*
+ * coverageSweep.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COVERAGESWEEP_H_
+#define COVERAGESWEEP_H_
+
+#include <functional>
+#include <vector>
+#include <arrayfire.h>
+
+#include "bitVolume.h"
+
+struct coverageSweepResult {
+    af::array feasible; // union of the indicators of the evaluated orientations
+    af::array count;    // number of evaluated orientations covering each voxel
+    std::vector<int> order; // the greedy evaluation order
+    std::vector<int> used;  // orientations that added voxels inside the roi
+    std::vector<long> gains; // new roi voxels of each orientation in used
+    int evaluations;
+    long covered;   // roi voxels covered by the union
+    long roiVoxels; // size of the roi
+    bool complete;  // true if the sweep stopped on full coverage
+};
+
+/*
+ * Greedy maximum coverage order of a set of (coarse) indicators: each step
+ * picks the indicator adding the most voxels not yet covered. Indicators
+ * that add nothing are appended in index order.
+ */
+std::vector<int> greedyCoverageOrder(const std::vector<bitVolume> &estimates);
+
+/*
+ * Orientation sweep that tracks coverage of roi. The n orientations are
+ * evaluated in the greedy order of their coarse estimates, estimate(i)
+ * being the indicator of orientation i at a cheap (e.g. downsampled)
+ * resolution, already restricted to the roi. The sweep stops as soon as
+ * every roi voxel is covered, or when an orientation adds fewer than
+ * minGain * roiVoxels new voxels (minGain <= 0 only stops on full
+ * coverage). An empty roi means the whole grid.
+ */
+coverageSweepResult coverageSweep(int n,
+        std::function<af::array(int index)> estimate,
+        std::function<af::array(int index)> evaluate, af::dim4 dims,
+        af::array roi = af::array(), double minGain = 0);
+
+#endif /* COVERAGESWEEP_H_ */
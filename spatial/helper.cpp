@@ -13,6 +13,10 @@
 #include <arrayfire.h>
 
 #include "helper.h"
+#include "voxelize.h"
+#include "meshExport.h"
+#include "renderQueue.h"
+#include "so3Grid.h"
 // vtk stuff
 #include <vtkSmartPointer.h>
 #include <vtkImageData.h>
@@ -30,6 +34,11 @@
 #include <vtkVolumeProperty.h>
 
 #include <vtkSTLWriter.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkWindowToImageFilter.h>
+#include <vtkPNGWriter.h>
 
 
 
@@ -70,6 +79,20 @@ std::vector<Eigen::Matrix3d> getRotationMatricesFromFile(const char* file){
 
 }
 
+std::vector<Eigen::Matrix3d> getRotationMatrices(int so3Level){
+
+    // get the rotation matrices of an SO(3) grid level (72 at level 0, 576
+    // at level 1, ...), generated in memory instead of read from a file
+    so3Grid grid = simpleSO3Grid(so3Level);
+    std::vector<Eigen::Matrix3d> rotationMatrices;
+    rotationMatrices.reserve(grid.size());
+    for (int i = 0; i < grid.size(); i++) {
+        rotationMatrices.push_back(grid.rotation(i));
+    }
+    return (rotationMatrices);
+
+}
+
 af::array read_binvox(string filespec) {
     // reads a binvox file
     static int version;
@@ -175,6 +198,23 @@ af::array read_binvox(string filespec) {
 
 }
 
+bool isSTL(string filespec) {
+    string ext = filespec.substr(filespec.find_last_of('.') + 1);
+    return ext.compare("stl") == 0 || ext.compare("STL") == 0;
+}
+
+af::array readShape(string filespec, int resolution, double voxelSize) {
+    // read a part or tool indicator. binvox files are read as is, stl meshes
+    // are voxelized in process (solid) at the requested resolution. A
+    // positive voxelSize (mesh units) puts several meshes on one scale,
+    // otherwise the mesh is fit to the grid.
+    if (isSTL(filespec)) {
+        return voxelizeSTL(filespec, resolution, Eigen::Matrix4d::Identity(),
+                VOXELIZE_SOLID, voxelSize);
+    }
+    return read_binvox(filespec);
+}
+
 /*af::array rotate(af::array input, Eigen::Matrix3d rotation){
     // rotate a 3d arrayfire array by an eigen rotation matrix
     input.eval(); // ensure it is not in use and has been executed
@@ -258,268 +298,133 @@ void writeSTL(vtkSmartPointer<vtkPolyData> polyData, std::string filename) {
 }
 
 void writeAFArray(array x, std::string filename) {
-    // copy data from device to host and visualize on vtk
-    // not sure how to do this visualization directly in AF
-    array x1 = x.as(f64);
-    double *host_x = x1.host<double>(); // copy from device to host - expensive
-    dim4 dim = x.dims();
-    //create image data
-    vtkSmartPointer<vtkImageData> imageData =
-            vtkSmartPointer<vtkImageData>::New();
-    //specify size of image data
-    imageData->SetDimensions(dim[0], dim[1], dim[2]);
-#if VTK_MAJOR_VERSION <= 5
-    imageData->SetNumberOfScalarComponents(1);
-    imageData->SetScalarTypeToDouble();
-#else
-    imageData->AllocateScalars(VTK_DOUBLE, 1);
-#endif
-    //populate imageData array
-    cout << "Copying to imageData and writing" << endl;
-    for (int k = 0; k < dim[2]; k++) {
-        for (int j = 0; j < dim[1]; j++) {
-            for (int i = 0; i < dim[0]; i++) {
-                double *voxel =
-                        static_cast<double*>(imageData->GetScalarPointer(i, j,
-                                k));
-                voxel[0] = host_x[j * dim[0] * dim[1] + i * dim[1] + k];
-            }
-        }
-    }
-
-    // Create a 3D model using marching cubes
-    vtkSmartPointer<vtkMarchingCubes> mc =
-            vtkSmartPointer<vtkMarchingCubes>::New();
-    mc->SetInputData(imageData);
-    mc->ComputeNormalsOn();
-    mc->ComputeGradientsOn();
-    mc->SetValue(0, 1);  // second value acts as threshold
-    mc->Update();
-
-    writeSTL(mc->GetOutput(), filename);
+    // write the iso-surface of x to disk. Marching cubes runs natively on the
+    // host copy in parallel slabs, there is no f64 copy or vtk round trip.
+    cout << "Extracting iso-surface and writing " << filename << endl;
+    exportIsosurface(x, filename);
+}
 
+struct hostVolume {
+    // host copy of a volume in arrayfire (column major) order
+    float *data;
+    int dims[3];
+};
+
+static hostVolume copyToHost(array x) {
+    // the only copy made for rendering -- f32, never f64
+    hostVolume v;
+    v.data = x.as(f32).host<float>();
+    for (int q = 0; q < 3; q++)
+        v.dims[q] = static_cast<int>(x.dims()[q]);
+    return v;
 }
 
-void visualize(array x) {
-    // copy data from device to host and visualize on vtk
-    // not sure how to do this visualization directly in AF
-    array x1 = x.as(f64);
-    double *host_x = x1.host<double>(); // copy from device to host - expensive
-    dim4 dim = x.dims();
-    //create image data
+static vtkSmartPointer<vtkImageData> wrapVolume(const hostVolume &v) {
+    // wrap the host buffer in a vtkImageData without copying. vtk and
+    // arrayfire are both x fastest so the buffer is used as is.
+    vtkSmartPointer<vtkFloatArray> scalars =
+            vtkSmartPointer<vtkFloatArray>::New();
+    vtkIdType n = static_cast<vtkIdType>(v.dims[0]) * v.dims[1] * v.dims[2];
+    scalars->SetArray(v.data, n, 1); // 1 = vtk does not own the buffer
     vtkSmartPointer<vtkImageData> imageData =
             vtkSmartPointer<vtkImageData>::New();
-    //specify size of image data
-    imageData->SetDimensions(dim[0], dim[1], dim[2]);
-#if VTK_MAJOR_VERSION <= 5
-    imageData->SetNumberOfScalarComponents(1);
-    imageData->SetScalarTypeToDouble();
-#else
-    imageData->AllocateScalars(VTK_DOUBLE, 1);
-#endif
-    //populate imageData array
-    cout << "Copying to imageData and visualizing" << endl;
-    for (int k = 0; k < dim[2]; k++) {
-        for (int j = 0; j < dim[1]; j++) {
-            for (int i = 0; i < dim[0]; i++) {
-                double *voxel =
-                        static_cast<double*>(imageData->GetScalarPointer(i, j,
-                                k));
-                voxel[0] = host_x[j * dim[0] * dim[1] + i * dim[1] + k];
-            }
-        }
-    }
+    imageData->SetDimensions(v.dims[0], v.dims[1], v.dims[2]);
+    imageData->GetPointData()->SetScalars(scalars);
+    return imageData;
+}
 
-    // Create a 3D model using marching cubes
-    vtkSmartPointer<vtkMarchingCubes> mc =
-            vtkSmartPointer<vtkMarchingCubes>::New();
-    mc->SetInputData(imageData);
-    mc->ComputeNormalsOn();
-    mc->ComputeGradientsOn();
-    mc->SetValue(0, 1);  // second value acts as threshold
-
-    // To remain largest region
-    vtkSmartPointer<vtkPolyDataConnectivityFilter> confilter = vtkSmartPointer<
-            vtkPolyDataConnectivityFilter>::New();
-    confilter->SetInputConnection(mc->GetOutputPort());
-    confilter->SetExtractionModeToLargestRegion();
-
-    bool extractMaxIsoSurface = false;
-    // Create a mapper
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<
-            vtkPolyDataMapper>::New();
-    if (extractMaxIsoSurface) {
-        mapper->SetInputConnection(confilter->GetOutputPort());
-    } else {
-        mapper->SetInputConnection(mc->GetOutputPort());
-    }
+static void renderVolumes(std::vector<hostVolume> volumes, renderMode mode) {
+    // iso-surface and render a set of host volumes, then release them
+    vtkSmartPointer<vtkRenderer> ren1 = vtkSmartPointer<vtkRenderer>::New();
+    ren1->SetBackground(0.1, 0.4, 0.2);
 
-    mapper->ScalarVisibilityOff();    // utilize actor's property I set
+    // volumes are indexed (dim 0, dim 1, dim 2) but were always shown with
+    // x = dim 1, y = dim 2 and z = dim 0; rotate the actors rather than
+    // transposing the data
+    const double permute[16] = { 0, 1, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0,
+            1 };
+    vtkSmartPointer<vtkMatrix4x4> axes = vtkSmartPointer<vtkMatrix4x4>::New();
+    axes->DeepCopy(permute);
+
+    for (size_t i = 0; i < volumes.size(); i++) {
+        // Create a 3D model using marching cubes
+        vtkSmartPointer<vtkMarchingCubes> mc =
+                vtkSmartPointer<vtkMarchingCubes>::New();
+        mc->SetInputData(wrapVolume(volumes[i]));
+        mc->ComputeNormalsOn();
+        mc->ComputeGradientsOn();
+        mc->SetValue(0, 1);  // second value acts as threshold
+
+        // Create a mapper
+        vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<
+                vtkPolyDataMapper>::New();
+        mapper->SetInputConnection(mc->GetOutputPort());
+        mapper->ScalarVisibilityOff();    // utilize actor's property I set
 
-    // Visualize
-    vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
-    actor->GetProperty()->SetColor(1, 1, 1);
-    actor->SetMapper(mapper);
+        vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+        actor->GetProperty()->SetColor(1, 1, 1);
+        actor->SetMapper(mapper);
+        actor->SetUserMatrix(axes);
+        ren1->AddViewProp(actor);
+    }
+    ren1->ResetCamera();
 
     vtkSmartPointer<vtkRenderWindow> renWin =
             vtkSmartPointer<vtkRenderWindow>::New();
-    vtkSmartPointer<vtkRenderer> ren1 = vtkSmartPointer<vtkRenderer>::New();
-    ren1->SetBackground(0.1, 0.4, 0.2);
-
-    ren1->AddViewProp(actor);
-    ren1->ResetCamera();
     renWin->AddRenderer(ren1);
     renWin->SetSize(301, 300); // intentional odd and NPOT  width/height
 
-    vtkSmartPointer<vtkRenderWindowInteractor> iren = vtkSmartPointer<
-            vtkRenderWindowInteractor>::New();
-    iren->SetRenderWindow(renWin);
-
-    renWin->Render(); // make sure we have an OpenGL context.
-    iren->Start();
-
-}
-
-
-void visualize2(array x, array y) {
-    // copy data from device to host and visualize on vtk
-    // not sure how to do this visualization directly in AF
-    array x1 = x.as(f64);
-    double *host_x = x1.host<double>(); // copy from device to host - expensive
-
-    array y1 = y.as(f64);
-    double *host_y = y1.host<double>(); // copy from device to host - expensive
-
-
-    dim4 dim = x.dims();
-    dim4 ydim = y.dims();
-
-    //create image data
-    vtkSmartPointer<vtkImageData> imageData =
-            vtkSmartPointer<vtkImageData>::New();
-    //specify size of image data
-    imageData->SetDimensions(dim[0], dim[1], dim[2]);
-#if VTK_MAJOR_VERSION <= 5
-    imageData->SetNumberOfScalarComponents(1);
-    imageData->SetScalarTypeToDouble();
-#else
-    imageData->AllocateScalars(VTK_DOUBLE, 1);
-#endif
-    //populate imageData array
-    cout << "Copying to imageData and visualizing" << endl;
-    for (int k = 0; k < dim[2]; k++) {
-        for (int j = 0; j < dim[1]; j++) {
-            for (int i = 0; i < dim[0]; i++) {
-                double *voxel =
-                        static_cast<double*>(imageData->GetScalarPointer(i, j,
-                                k));
-                voxel[0] = host_x[j * dim[0] * dim[1] + i * dim[1] + k];
-            }
-        }
-    }
-
-    //create image data
-    vtkSmartPointer<vtkImageData> imageData2 =
-            vtkSmartPointer<vtkImageData>::New();
-    //specify size of image data
-    imageData->SetDimensions(ydim[0], ydim[1], ydim[2]);
-#if VTK_MAJOR_VERSION <= 5
-    imageData2->SetNumberOfScalarComponents(1);
-    imageData2->SetScalarTypeToDouble();
-#else
-    imageData2->AllocateScalars(VTK_DOUBLE, 1);
-#endif
-    //populate imageData array
-    cout << "Copying to imageData 2 and visualizing" << endl;
-    for (int k = 0; k < ydim[2]; k++) {
-        for (int j = 0; j < ydim[1]; j++) {
-            for (int i = 0; i < ydim[0]; i++) {
-                double *voxel =
-                        static_cast<double*>(imageData2->GetScalarPointer(i, j,
-                                k));
-                voxel[0] = host_y[j * dim[0] * dim[1] + i * dim[1] + k];
-            }
-        }
-    }
-    // Create a 3D model using marching cubes -- for X
-    vtkSmartPointer<vtkMarchingCubes> mc =
-            vtkSmartPointer<vtkMarchingCubes>::New();
-    mc->SetInputData(imageData);
-    mc->ComputeNormalsOn();
-    mc->ComputeGradientsOn();
-    mc->SetValue(0, 1);  // second value acts as threshold
-
-    // To remain largest region
-    vtkSmartPointer<vtkPolyDataConnectivityFilter> confilter = vtkSmartPointer<
-            vtkPolyDataConnectivityFilter>::New();
-    confilter->SetInputConnection(mc->GetOutputPort());
-    confilter->SetExtractionModeToLargestRegion();
-
-
-    // Create a 3D model using marching cubes
-    vtkSmartPointer<vtkMarchingCubes> mc2 =
-            vtkSmartPointer<vtkMarchingCubes>::New();
-    mc2->SetInputData(imageData2);
-    mc2->ComputeNormalsOn();
-    mc2->ComputeGradientsOn();
-    mc2->SetValue(0, 1);  // second value acts as threshold
-
-    // To remain largest region
-    vtkSmartPointer<vtkPolyDataConnectivityFilter> confilter2 = vtkSmartPointer<
-            vtkPolyDataConnectivityFilter>::New();
-    confilter2->SetInputConnection(mc2->GetOutputPort());
-    confilter2->SetExtractionModeToLargestRegion();
-
-    bool extractMaxIsoSurface = false;
-    // Create a mapper
-    vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<
-            vtkPolyDataMapper>::New();
-    if (extractMaxIsoSurface) {
-        mapper->SetInputConnection(confilter->GetOutputPort());
+    if (mode == RENDER_OFFSCREEN) {
+        renWin->SetOffScreenRendering(1);
+        renWin->Render();
+        vtkSmartPointer<vtkWindowToImageFilter> screenshot = vtkSmartPointer<
+                vtkWindowToImageFilter>::New();
+        screenshot->SetInput(renWin);
+        screenshot->Update();
+        vtkSmartPointer<vtkPNGWriter> writer =
+                vtkSmartPointer<vtkPNGWriter>::New();
+        writer->SetFileName(nextRenderFilename("visualize").c_str());
+        writer->SetInputConnection(screenshot->GetOutputPort());
+        writer->Write();
     } else {
-        mapper->SetInputConnection(mc->GetOutputPort());
+        vtkSmartPointer<vtkRenderWindowInteractor> iren = vtkSmartPointer<
+                vtkRenderWindowInteractor>::New();
+        iren->SetRenderWindow(renWin);
+        renWin->Render(); // make sure we have an OpenGL context.
+        iren->Start();
     }
 
-    mapper->ScalarVisibilityOff();    // utilize actor's property I set
+    for (size_t i = 0; i < volumes.size(); i++)
+        af::freeHost(volumes[i].data);
+}
 
-    // Create a mapper
-    vtkSmartPointer<vtkPolyDataMapper> mapper2 = vtkSmartPointer<
-            vtkPolyDataMapper>::New();
-    if (extractMaxIsoSurface) {
-        mapper2->SetInputConnection(confilter2->GetOutputPort());
+static void visualizeVolumes(std::vector<array> xs) {
+    // render according to the render mode. Offscreen renders run on the
+    // background render thread so the caller only waits for the host copy.
+    renderMode mode = getRenderMode();
+    if (mode == RENDER_NONE)
+        return;
+    std::vector<hostVolume> volumes;
+    for (size_t i = 0; i < xs.size(); i++)
+        volumes.push_back(copyToHost(xs[i]));
+    if (mode == RENDER_OFFSCREEN) {
+        enqueueRender([volumes, mode]() {renderVolumes(volumes, mode);});
     } else {
-        mapper2->SetInputConnection(mc2->GetOutputPort());
+        renderVolumes(volumes, mode);
     }
+}
 
-    mapper->ScalarVisibilityOff();    // utilize actor's property I set
-
-    // Visualize
-    vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
-    actor->GetProperty()->SetColor(1, 1, 1);
-    actor->SetMapper(mapper);
-
-    // Visualize
-    vtkSmartPointer<vtkActor> actor2 = vtkSmartPointer<vtkActor>::New();
-    actor2->GetProperty()->SetColor(1, 1, 1);
-    actor2->SetMapper(mapper);
-
-    vtkSmartPointer<vtkRenderWindow> renWin =
-            vtkSmartPointer<vtkRenderWindow>::New();
-    vtkSmartPointer<vtkRenderer> ren1 = vtkSmartPointer<vtkRenderer>::New();
-    ren1->SetBackground(0.1, 0.4, 0.2);
-
-    ren1->AddViewProp(actor);
-    ren1->AddViewProp(actor2);
-    ren1->ResetCamera();
-    renWin->AddRenderer(ren1);
-    renWin->SetSize(301, 300); // intentional odd and NPOT  width/height
-
-    vtkSmartPointer<vtkRenderWindowInteractor> iren = vtkSmartPointer<
-            vtkRenderWindowInteractor>::New();
-    iren->SetRenderWindow(renWin);
-
-    renWin->Render(); // make sure we have an OpenGL context.
-    iren->Start();
-
+void visualize(array x) {
+    // visualize the iso-surface of a volume
+    std::vector<array> xs;
+    xs.push_back(x);
+    visualizeVolumes(xs);
 }
 
+void visualize2(array x, array y) {
+    // visualize the iso-surfaces of two volumes together
+    std::vector<array> xs;
+    xs.push_back(x);
+    xs.push_back(y);
+    visualizeVolumes(xs);
+}
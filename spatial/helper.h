@@ -15,6 +15,8 @@
 typedef unsigned char byte;
  
 af::array read_binvox(std::string filespec); 
+af::array readShape(std::string filespec, int resolution, double voxelSize = 0);
+bool isSTL(std::string filespec);
 void visualize(af::array x);
 void visualize2(af::array x, af::array y);
 
@@ -22,5 +24,6 @@ void writeAFArray(af::array x, std::string filename);
 
 
 std::vector<Eigen::Matrix3d> getRotationMatricesFromFile(const char* file);
+std::vector<Eigen::Matrix3d> getRotationMatrices(int so3Level);
 
 #endif /* HELPER_H_ */
@@ -0,0 +1,26 @@
+/*
+ * labelStats.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "labelStats.h"
+
+std::vector<unsigned> labelHistogram(af::array labels, af::array classes,
+        int nLabels, int nClasses) {
+    // bin k holds key k, minval 0 and maxval nbins give unit wide bins
+    int nbins = (nLabels + 1) * nClasses;
+    af::array key = labels.as(f32) * nClasses + classes.as(f32);
+    af::array h = af::histogram(af::flat(key), nbins, 0, nbins);
+    std::vector<unsigned> counts(nbins);
+    h.as(u32).host(&counts[0]);
+    return counts;
+}
+
+std::vector<unsigned> labelCounts(af::array labels, af::array mask, int nLabels) {
+    std::vector<unsigned> h = labelHistogram(labels, mask > 0, nLabels, 2);
+    std::vector<unsigned> counts(nLabels + 1);
+    for (int k = 0; k <= nLabels; k++)
+        counts[k] = h[2 * k + 1];
+    return counts;
+}
@@ -0,0 +1,27 @@
+/*
+ * labelStats.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef LABELSTATS_H_
+#define LABELSTATS_H_
+
+#include <vector>
+#include <arrayfire.h>
+
+/*
+ * Per label reductions over a labelled volume (e.g. af::regions output) in
+ * one pass, instead of one indicator(labels == k) pass per label.
+ */
+
+// Joint histogram of labels in [0, nLabels] and classes in [0, nClasses):
+// counts[label * nClasses + class] is the number of voxels with that label
+// and class. One device histogram over a combined key.
+std::vector<unsigned> labelHistogram(af::array labels, af::array classes,
+        int nLabels, int nClasses);
+
+// number of voxels of each label in [0, nLabels] inside mask
+std::vector<unsigned> labelCounts(af::array labels, af::array mask, int nLabels);
+
+#endif /* LABELSTATS_H_ */
@@ -18,6 +18,9 @@
 
 #include "ufabRV.h"
 #include "helper.h"
+#include "voxelize.h"
+#include "renderQueue.h"
+#include "memoryArena.h"
 
 using namespace std;
 
@@ -26,27 +29,39 @@ using namespace std;
 int main(int argc, char *argv[]) {
     try {
 
-        if(argc !=4 ){
-            cout << "usage: ./spatialTests partFile.binvox toolAssembly.binvox quaternionFile";
+        if(argc < 3 || argc > 5){
+            cout << "usage: ./spatialTests partFile.(binvox|stl) toolAssembly.(binvox|stl) [so3Level] [stlResolution]";
             exit(1);
         }
+        // SO(3) grid level, 72 rotations at level 0 and 576 at level 1
+        int so3Level = (argc >= 4) ? atoi(argv[3]) : 1;
+        // voxel resolution used when the part or tool is given as an stl mesh
+        int stlResolution = (argc == 5) ? atoi(argv[4]) : 128;
         // Select a device and display arrayfire info
         af::setDevice(6);
         af::info();
+        // recycle the buffers of the orientation sweep (cpu backend)
+        if (useMemoryArena()) {
+            cout << "Using the memory arena" << endl;
+        }
 
         int ndevices = getDeviceCount(); // number of available GPUs
-        cout << "Reading rotation file ..";
-        std::vector<Eigen::Matrix3d> rotationMatrices = getRotationMatricesFromFile(argv[3]);
-        cout << "done" << endl;
+        cout << "Generating rotations ..";
+        std::vector<Eigen::Matrix3d> rotationMatrices = getRotationMatrices(so3Level);
+        cout << rotationMatrices.size() << " done" << endl;
+
+        // stl part and tool share the voxel size that fits the part to the
+        // grid, so the tool keeps its size relative to the part
+        double voxelSize = isSTL(argv[1]) ? stlVoxelSize(argv[1], stlResolution) : 0;
 
         // part assembly indicator function
-        af::array part = read_binvox(argv[1]);
-        int partDim = part.dims()[0];
+        af::array part = readShape(argv[1], stlResolution, voxelSize);
+        dim4 partDims = part.dims();
         //writeAFArray(part, "part.stl");
         //visualize(part);
 
         // tool assembly indicator function
-        af::array toolAssembly = read_binvox(argv[2]);
+        af::array toolAssembly = readShape(argv[2], stlResolution, voxelSize);
         writeAFArray(rotate(toolAssembly,45, true, AF_INTERP_BICUBIC_SPLINE),"rotated45.stl");
         writeAFArray(reorder(toolAssembly, 2, 1, 0), "swapxz.stl");
         writeAFArray(rotate(reorder(toolAssembly, 2, 1, 0),45, true, AF_INTERP_BICUBIC_SPLINE),"swapxz_rotated45.stl");
@@ -56,19 +71,21 @@ int main(int argc, char *argv[]) {
 
         //writeAFArray(toolAssembly, "tool.stl");
 
-        //assume tool assembly voxel resolution is tDim * tDim * tDim
-        int tDim = toolAssembly.dims()[0];
-
-
-        int resultDim = partDim + tDim -1;
+        // part and tool grids need not be cubic, the expanded convolution
+        // grows every axis by the tool size on that axis
+        dim4 toolDims = toolAssembly.dims();
+        dim4 resultDims(partDims[0] + toolDims[0] - 1, partDims[1] + toolDims[1] - 1,
+                partDims[2] + toolDims[2] - 1);
         int n = 10; // 10 r-slices can be fit on a GPU
-        af::array rSlices = af::array(resultDim, resultDim, resultDim, n);
+        af::array rSlices = af::array(resultDims[0], resultDims[1], resultDims[2], n);
 
-        af::array projectedBoundary= constant(0,resultDim, resultDim,resultDim,f32);
+        af::array projectedBoundary= constant(0,resultDims,f32);
 
         //omp_set_num_threads(ndevices-1);
 
-        cout << "Part and tool dimensions = "<< partDim << "," << tDim << endl;
+        cout << "Part and tool dimensions = " << partDims[0] << "x" << partDims[1] << "x"
+                << partDims[2] << "," << toolDims[0] << "x" << toolDims[1] << "x"
+                << toolDims[2] << endl;
         cout << "starting " << endl;
 
         /*
@@ -98,10 +115,21 @@ int main(int argc, char *argv[]) {
         /*        }
         }*/
         cout << "Done computing in  " << af::timer::stop() << " s" << endl;
+
+        // union over orientations, refined adaptively up to the SO(3) level
+        af::timer::start();
+        af::array infPocket = toolPlungeVolume(5, 5, 5);
+        af::array reachable = maxRVAdaptive(part, toolAssembly, infPocket, 0, so3Level);
+        cout << "Done computing adaptive sweep in  " << af::timer::stop() << " s" << endl;
+        writeAFArray(reachable, "reachable.stl");
+        printMemoryArenaStats();
         //visualize(projectedBoundary);
 
         //}
 
+        // let queued offscreen renders finish before exiting
+        waitForRenders();
+
     } catch (af::exception& e) {
         fprintf(stderr, "%s\n", e.what());
         throw;
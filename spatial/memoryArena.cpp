@@ -0,0 +1,273 @@
+/*
+ * memoryArena.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <arrayfire.h>
+
+#include "memoryArena.h"
+
+#if AF_API_VERSION >= 37
+#include <af/memory.h>
+
+using namespace std;
+
+struct arenaBlock {
+    size_t bytes;
+    bool locked;     // in use by arrayfire
+    bool userLocked; // in use through af::array::lock or device()
+};
+
+struct memoryArena {
+    std::mutex lock;
+    // free buffers by exact size
+    std::map<size_t, std::vector<void *> > freeLists;
+    std::unordered_map<void *, arenaBlock> blocks;
+    size_t maxCached;
+    size_t cachedBytes; // in the free lists
+    size_t lockedBytes; // handed out
+    size_t peakBytes;   // largest cached + locked
+    long hits, misses;
+};
+
+static memoryArena arena;
+static bool active = false;
+
+static void releaseCached(af_memory_manager handle) {
+    // give every free buffer back to the backend, arena.lock held
+    for (auto &list : arena.freeLists) {
+        for (void *ptr : list.second) {
+            af_memory_manager_native_free(handle, ptr);
+            arena.blocks.erase(ptr);
+        }
+    }
+    arena.freeLists.clear();
+    arena.cachedBytes = 0;
+}
+
+static void release(af_memory_manager handle, void *ptr, arenaBlock &block) {
+    // a buffer no longer locked goes back to its free list, or to the
+    // backend if the cache is full; arena.lock held
+    arena.lockedBytes -= block.bytes;
+    if (arena.cachedBytes + block.bytes > arena.maxCached) {
+        af_memory_manager_native_free(handle, ptr);
+        arena.blocks.erase(ptr);
+        return;
+    }
+    arena.freeLists[block.bytes].push_back(ptr);
+    arena.cachedBytes += block.bytes;
+}
+
+static af_err arenaInitialize(af_memory_manager handle) {
+    return AF_SUCCESS;
+}
+
+static af_err arenaShutdown(af_memory_manager handle) {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    releaseCached(handle);
+    return AF_SUCCESS;
+}
+
+static af_err arenaAlloc(af_memory_manager handle, void **ptr, int userLock,
+        const unsigned ndims, dim_t *dims, const unsigned elementSize) {
+    size_t bytes = elementSize;
+    for (unsigned i = 0; i < ndims; i++)
+        bytes *= dims[i];
+    *ptr = 0;
+    if (bytes == 0)
+        return AF_SUCCESS;
+
+    std::lock_guard<std::mutex> guard(arena.lock);
+    auto list = arena.freeLists.find(bytes);
+    if (list != arena.freeLists.end() && !list->second.empty()) {
+        *ptr = list->second.back();
+        list->second.pop_back();
+        arena.cachedBytes -= bytes;
+        arena.hits++;
+    } else {
+        af_err err = af_memory_manager_native_alloc(handle, ptr, bytes);
+        if (err != AF_SUCCESS || *ptr == 0) {
+            // out of memory, drop the cached buffers and try once more
+            releaseCached(handle);
+            err = af_memory_manager_native_alloc(handle, ptr, bytes);
+            if (err != AF_SUCCESS)
+                return err;
+        }
+        arena.misses++;
+    }
+    arenaBlock block;
+    block.bytes = bytes;
+    block.locked = true;
+    block.userLocked = userLock != 0;
+    arena.blocks[*ptr] = block;
+    arena.lockedBytes += bytes;
+    arena.peakBytes = std::max(arena.peakBytes,
+            arena.lockedBytes + arena.cachedBytes);
+    return AF_SUCCESS;
+}
+
+static af_err arenaAllocated(af_memory_manager handle, size_t *size,
+        void *ptr) {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    auto it = arena.blocks.find(ptr);
+    *size = (it == arena.blocks.end()) ? 0 : it->second.bytes;
+    return AF_SUCCESS;
+}
+
+static af_err arenaUnlock(af_memory_manager handle, void *ptr,
+        int userUnlock) {
+    if (ptr == 0)
+        return AF_SUCCESS;
+    std::lock_guard<std::mutex> guard(arena.lock);
+    auto it = arena.blocks.find(ptr);
+    if (it == arena.blocks.end())
+        return AF_SUCCESS;
+    arenaBlock &block = it->second;
+    if (userUnlock)
+        block.userLocked = false;
+    else
+        block.locked = false;
+    if (!block.locked && !block.userLocked)
+        release(handle, ptr, block);
+    return AF_SUCCESS;
+}
+
+static af_err arenaSignalCleanup(af_memory_manager handle) {
+    // af::deviceGC, still honoured but no longer needed by the loops
+    std::lock_guard<std::mutex> guard(arena.lock);
+    releaseCached(handle);
+    return AF_SUCCESS;
+}
+
+static af_err arenaPrintInfo(af_memory_manager handle, char *msg,
+        int device) {
+    printMemoryArenaStats();
+    return AF_SUCCESS;
+}
+
+static af_err arenaUserLock(af_memory_manager handle, void *ptr) {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    auto it = arena.blocks.find(ptr);
+    if (it != arena.blocks.end())
+        it->second.userLocked = true;
+    return AF_SUCCESS;
+}
+
+static af_err arenaUserUnlock(af_memory_manager handle, void *ptr) {
+    return arenaUnlock(handle, ptr, 1);
+}
+
+static af_err arenaIsUserLocked(af_memory_manager handle, void *ptr,
+        int *out) {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    auto it = arena.blocks.find(ptr);
+    *out = (it != arena.blocks.end()) && it->second.userLocked;
+    return AF_SUCCESS;
+}
+
+static af_err arenaMemoryPressure(af_memory_manager handle,
+        float *pressure) {
+    size_t maxBytes = 0;
+    af_memory_manager_get_max_memory_size(handle, &maxBytes, 0);
+    std::lock_guard<std::mutex> guard(arena.lock);
+    *pressure = maxBytes ? static_cast<float>(arena.lockedBytes) / maxBytes : 0.f;
+    return AF_SUCCESS;
+}
+
+static af_err arenaJitTreeExceeds(af_memory_manager handle, int *out,
+        size_t bytes) {
+    // evaluate a jit tree once its buffers outweigh what is in use, like
+    // the default manager
+    std::lock_guard<std::mutex> guard(arena.lock);
+    *out = 2 * bytes > arena.lockedBytes;
+    return AF_SUCCESS;
+}
+
+static void arenaAddDevice(af_memory_manager handle, int id) {
+}
+
+static void arenaRemoveDevice(af_memory_manager handle, int id) {
+}
+
+bool useMemoryArena() {
+    if (active)
+        return true;
+    const char *mb = getenv("IMSENSE_MEMORY_ARENA_MB");
+    size_t maxCached = static_cast<size_t>(mb ? atol(mb) : 2048) << 20;
+    if (maxCached == 0 || af::getActiveBackend() != AF_BACKEND_CPU)
+        return false;
+
+    arena.maxCached = maxCached;
+    arena.cachedBytes = arena.lockedBytes = arena.peakBytes = 0;
+    arena.hits = arena.misses = 0;
+
+    af_memory_manager handle;
+    if (af_create_memory_manager(&handle) != AF_SUCCESS) {
+        cout << "Could not create the memory arena" << endl;
+        return false;
+    }
+    af_memory_manager_set_initialize_fn(handle, arenaInitialize);
+    af_memory_manager_set_shutdown_fn(handle, arenaShutdown);
+    af_memory_manager_set_alloc_fn(handle, arenaAlloc);
+    af_memory_manager_set_allocated_fn(handle, arenaAllocated);
+    af_memory_manager_set_unlock_fn(handle, arenaUnlock);
+    af_memory_manager_set_signal_memory_cleanup_fn(handle, arenaSignalCleanup);
+    af_memory_manager_set_print_info_fn(handle, arenaPrintInfo);
+    af_memory_manager_set_user_lock_fn(handle, arenaUserLock);
+    af_memory_manager_set_user_unlock_fn(handle, arenaUserUnlock);
+    af_memory_manager_set_is_user_locked_fn(handle, arenaIsUserLocked);
+    af_memory_manager_set_get_memory_pressure_fn(handle, arenaMemoryPressure);
+    af_memory_manager_set_jit_tree_exceeds_memory_pressure_fn(handle,
+            arenaJitTreeExceeds);
+    af_memory_manager_set_add_memory_management_fn(handle, arenaAddDevice);
+    af_memory_manager_set_remove_memory_management_fn(handle,
+            arenaRemoveDevice);
+    if (af_set_memory_manager(handle) != AF_SUCCESS) {
+        cout << "Could not install the memory arena" << endl;
+        af_release_memory_manager(handle);
+        return false;
+    }
+    active = true;
+    return true;
+}
+
+bool memoryArenaActive() {
+    return active;
+}
+
+void printMemoryArenaStats() {
+    if (!active)
+        return;
+    std::lock_guard<std::mutex> guard(arena.lock);
+    cout << "Memory arena: " << arena.hits << " reused, " << arena.misses
+            << " allocated, peak " << (arena.peakBytes >> 20) << " MB, cached "
+            << (arena.cachedBytes >> 20) << " MB in " << arena.freeLists.size()
+            << " sizes" << endl;
+}
+
+#else
+
+// arrayfire before 3.7 has no memory manager interface
+
+bool useMemoryArena() {
+    return false;
+}
+
+bool memoryArenaActive() {
+    return false;
+}
+
+void printMemoryArenaStats() {
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * memoryArena.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef MEMORYARENA_H_
+#define MEMORYARENA_H_
+
+/*
+ * arrayfire memory manager for the orientation loops. Every orientation
+ * allocates the same few buffers (rotated tool, spectra, overlap field,
+ * feasible set), so freed buffers are kept in one free list per exact size
+ * and handed back to the next request of that size. Nothing is garbage
+ * collected behind the loop's back: a buffer is recycled as soon as
+ * arrayfire unlocks it, and the cached memory is only released when it
+ * exceeds the cap or an allocation fails.
+ *
+ * Installed for the cpu backend. The cap is IMSENSE_MEMORY_ARENA_MB
+ * (default 2048), 0 keeps arrayfire's default manager.
+ */
+
+// install the arena manager if the active backend is the cpu, returns
+// whether it is in use
+bool useMemoryArena();
+
+bool memoryArenaActive();
+
+// allocations served from the free lists and from the system, peak and
+// cached bytes; prints nothing if the arena is not in use
+void printMemoryArenaStats();
+
+#endif /* MEMORYARENA_H_ */
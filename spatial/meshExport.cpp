@@ -0,0 +1,306 @@
+/*
+ * meshExport.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <stdint.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#include "meshExport.h"
+
+using namespace std;
+
+// Cube corners and edges use the usual marching cubes numbering
+static const int cornerOffset[8][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 },
+        { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } };
+static const int edgeCorners[12][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+        { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 }, { 0, 4 }, { 1, 5 }, { 2, 6 },
+        { 3, 7 } };
+// corners of each face, counter clockwise as seen from outside the cube
+static const int faceCorners[6][4] = { { 0, 3, 2, 1 }, { 4, 5, 6, 7 }, { 0, 1,
+        5, 4 }, { 2, 3, 7, 6 }, { 3, 0, 4, 7 }, { 1, 2, 6, 5 } };
+
+static int edgeIndex(int c0, int c1) {
+    for (int e = 0; e < 12; e++) {
+        if ((edgeCorners[e][0] == c0 && edgeCorners[e][1] == c1)
+                || (edgeCorners[e][0] == c1 && edgeCorners[e][1] == c0))
+            return e;
+    }
+    return -1;
+}
+
+static std::vector<std::vector<int> > buildTriangleTable() {
+    /*
+     * Build the marching cubes case table instead of hard coding it. On every
+     * face the crossing edges are joined into directed segments (a corner
+     * inside the surface is always cut off on its own, which resolves the
+     * ambiguous faces the same way from both neighbouring cubes). Every
+     * crossing edge starts one segment and ends another, so the segments
+     * chain into closed loops which are fan triangulated.
+     */
+    std::vector<std::vector<int> > table(256);
+    for (int config = 0; config < 256; config++) {
+        int next[12];
+        std::fill(next, next + 12, -1);
+        for (int f = 0; f < 6; f++) {
+            int in[4];
+            for (int k = 0; k < 4; k++)
+                in[k] = (config >> faceCorners[f][k]) & 1;
+            // walk the face, an edge going outside->inside starts a segment
+            // which ends at the next edge going inside->outside
+            for (int k = 0; k < 4; k++) {
+                int k1 = (k + 1) % 4;
+                if (in[k] || !in[k1])
+                    continue;
+                for (int j = 1; j < 4; j++) {
+                    int m = (k + j) % 4;
+                    int m1 = (m + 1) % 4;
+                    if (in[m] && !in[m1]) {
+                        next[edgeIndex(faceCorners[f][k], faceCorners[f][k1])] =
+                                edgeIndex(faceCorners[f][m], faceCorners[f][m1]);
+                        break;
+                    }
+                }
+            }
+        }
+        bool used[12] = { false };
+        for (int e = 0; e < 12; e++) {
+            if (next[e] < 0 || used[e])
+                continue;
+            std::vector<int> loop;
+            for (int c = e; !used[c]; c = next[c]) {
+                used[c] = true;
+                loop.push_back(c);
+            }
+            for (size_t i = 1; i + 1 < loop.size(); i++) {
+                table[config].push_back(loop[0]);
+                table[config].push_back(loop[i]);
+                table[config].push_back(loop[i + 1]);
+            }
+        }
+    }
+    return table;
+}
+
+struct meshSlab {
+    // surface extracted from a slab of cells
+    std::unordered_map<uint64_t, unsigned int> edgeVertex; // edge id -> local vertex
+    std::vector<uint64_t> edgeIds;
+    std::vector<float> vertices;
+    std::vector<unsigned int> triangles;
+};
+
+template<typename T>
+static triangleMesh extract(const T *data, const long dims[3], float iso) {
+    static const std::vector<std::vector<int> > table = buildTriangleTable();
+
+    // The volume is padded by one empty voxel on every side, so point p in
+    // the padded grid is voxel p-1. Edge ids are 3*(padded point index)+axis.
+    const long P0 = dims[0] + 2, P1 = dims[1] + 2, P2 = dims[2] + 2;
+    const float outside = std::min(0.0f, iso - 1);
+
+    auto sample = [&](long a, long b, long c) -> float {
+        a -= 1; b -= 1; c -= 1;
+        if (a < 0 || b < 0 || c < 0 || a >= dims[0] || b >= dims[1]
+                || c >= dims[2])
+            return outside;
+        return static_cast<float>(data[a + dims[0] * (b + dims[1] * c)]);
+    };
+
+    int nslabs = std::max(1L, std::min(P2 - 1, 4L * omp_get_max_threads()));
+    std::vector<meshSlab> slabs(nslabs);
+    std::vector<long> slabStart(nslabs + 1);
+    for (int s = 0; s <= nslabs; s++)
+        slabStart[s] = (P2 - 1) * s / nslabs;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < nslabs; s++) {
+        meshSlab &slab = slabs[s];
+        for (long c = slabStart[s]; c < slabStart[s + 1]; c++) {
+            for (long b = 0; b < P1 - 1; b++) {
+                for (long a = 0; a < P0 - 1; a++) {
+                    float v[8];
+                    int config = 0;
+                    for (int k = 0; k < 8; k++) {
+                        v[k] = sample(a + cornerOffset[k][0],
+                                b + cornerOffset[k][1], c + cornerOffset[k][2]);
+                        if (v[k] > iso)
+                            config |= (1 << k);
+                    }
+                    const std::vector<int> &tris = table[config];
+                    for (size_t t = 0; t < tris.size(); t++) {
+                        int c0 = edgeCorners[tris[t]][0];
+                        int c1 = edgeCorners[tris[t]][1];
+                        // base corner of the edge and its axis
+                        int lo = c0, hi = c1;
+                        int axis = 0;
+                        for (int q = 0; q < 3; q++) {
+                            if (cornerOffset[c0][q] != cornerOffset[c1][q]) {
+                                axis = q;
+                                if (cornerOffset[c0][q] > cornerOffset[c1][q])
+                                    std::swap(lo, hi);
+                            }
+                        }
+                        long pa = a + cornerOffset[lo][0];
+                        long pb = b + cornerOffset[lo][1];
+                        long pc = c + cornerOffset[lo][2];
+                        uint64_t id = 3 * static_cast<uint64_t>(pa + P0 * (pb + P1 * pc))
+                                + axis;
+                        auto found = slab.edgeVertex.find(id);
+                        if (found != slab.edgeVertex.end()) {
+                            slab.triangles.push_back(found->second);
+                            continue;
+                        }
+                        float tt = (iso - v[lo]) / (v[hi] - v[lo]);
+                        float p[3] = { static_cast<float>(pa - 1),
+                                static_cast<float>(pb - 1),
+                                static_cast<float>(pc - 1) };
+                        p[axis] += tt;
+                        // emit in the axis order writeAFArray always used:
+                        // x = dim 1, y = dim 2, z = dim 0
+                        unsigned int vid = static_cast<unsigned int>(slab.edgeIds.size());
+                        slab.vertices.push_back(p[1]);
+                        slab.vertices.push_back(p[2]);
+                        slab.vertices.push_back(p[0]);
+                        slab.edgeIds.push_back(id);
+                        slab.edgeVertex[id] = vid;
+                        slab.triangles.push_back(vid);
+                    }
+                }
+            }
+        }
+    }
+
+    // weld the slabs -- the only vertices two slabs share are those on
+    // edges lying in the plane between them
+    triangleMesh mesh;
+    std::vector<std::vector<unsigned int> > globalId(nslabs);
+    for (int s = 0; s < nslabs; s++) {
+        meshSlab &slab = slabs[s];
+        globalId[s].resize(slab.edgeIds.size());
+        for (size_t i = 0; i < slab.edgeIds.size(); i++) {
+            uint64_t id = slab.edgeIds[i];
+            long pc = static_cast<long>((id / 3) / (P0 * P1));
+            if (s > 0 && id % 3 != 2 && pc == slabStart[s]) {
+                auto found = slabs[s - 1].edgeVertex.find(id);
+                if (found != slabs[s - 1].edgeVertex.end()) {
+                    globalId[s][i] = globalId[s - 1][found->second];
+                    continue;
+                }
+            }
+            globalId[s][i] = static_cast<unsigned int>(mesh.vertices.size() / 3);
+            mesh.vertices.insert(mesh.vertices.end(),
+                    slab.vertices.begin() + 3 * i,
+                    slab.vertices.begin() + 3 * i + 3);
+        }
+        for (size_t t = 0; t < slab.triangles.size(); t++)
+            mesh.triangles.push_back(globalId[s][slab.triangles[t]]);
+        // the hash of slab s is still needed by slab s+1
+        if (s > 0) {
+            std::unordered_map<uint64_t, unsigned int>().swap(
+                    slabs[s - 1].edgeVertex);
+            std::vector<float>().swap(slabs[s - 1].vertices);
+        }
+    }
+    return mesh;
+}
+
+triangleMesh marchingCubes(const float *data, const long dims[3], float iso) {
+    return extract(data, dims, iso);
+}
+
+triangleMesh marchingCubes(const unsigned char *data, const long dims[3],
+        float iso) {
+    return extract(data, dims, iso);
+}
+
+void writeMeshSTL(const triangleMesh &mesh, string filename) {
+    // binary stl, triangles are streamed out with their facet normals
+    ofstream out(filename.c_str(), ios::out | ios::binary);
+    if (!out) {
+        cout << "Unable to open " << filename << endl;
+        exit(1);
+    }
+    char header[80] = "imsense marching cubes";
+    out.write(header, 80);
+    uint32_t ntriangles = static_cast<uint32_t>(mesh.triangles.size() / 3);
+    out.write(reinterpret_cast<const char*>(&ntriangles), 4);
+
+    const float *v = mesh.vertices.data();
+    char record[50] = { 0 };
+    for (uint32_t t = 0; t < ntriangles; t++) {
+        const float *p0 = v + 3 * mesh.triangles[3 * t];
+        const float *p1 = v + 3 * mesh.triangles[3 * t + 1];
+        const float *p2 = v + 3 * mesh.triangles[3 * t + 2];
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float f[12] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0]
+                - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0], p0[0], p0[1],
+                p0[2], p1[0], p1[1], p1[2], p2[0], p2[1], p2[2] };
+        float len = sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+        if (len > 0) {
+            f[0] /= len;
+            f[1] /= len;
+            f[2] /= len;
+        }
+        std::copy(reinterpret_cast<const char*>(f),
+                reinterpret_cast<const char*>(f) + 48, record);
+        out.write(record, 50);
+    }
+    out.close();
+}
+
+void writeMeshPLY(const triangleMesh &mesh, string filename) {
+    // indexed binary ply, keeps the welded vertices
+    ofstream out(filename.c_str(), ios::out | ios::binary);
+    if (!out) {
+        cout << "Unable to open " << filename << endl;
+        exit(1);
+    }
+    size_t nvertices = mesh.vertices.size() / 3;
+    size_t ntriangles = mesh.triangles.size() / 3;
+    out << "ply\nformat binary_little_endian 1.0\n" << "element vertex "
+            << nvertices << "\nproperty float x\nproperty float y\n"
+            << "property float z\nelement face " << ntriangles
+            << "\nproperty list uchar uint vertex_indices\nend_header\n";
+    out.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+            mesh.vertices.size() * sizeof(float));
+    unsigned char three = 3;
+    for (size_t t = 0; t < ntriangles; t++) {
+        out.write(reinterpret_cast<const char*>(&three), 1);
+        out.write(reinterpret_cast<const char*>(&mesh.triangles[3 * t]),
+                3 * sizeof(unsigned int));
+    }
+    out.close();
+}
+
+void exportIsosurface(af::array x, string filename, float iso) {
+    // copy the volume to host in its own precision (f32 or 8 bit) rather
+    // than as f64, extract the surface and write it
+    long dims[3] = { static_cast<long>(x.dims()[0]),
+            static_cast<long>(x.dims()[1]), static_cast<long>(x.dims()[2]) };
+    triangleMesh mesh;
+    if (x.type() == b8 || x.type() == u8) {
+        unsigned char *host_x = x.as(u8).host<unsigned char>();
+        mesh = marchingCubes(host_x, dims, iso);
+        af::freeHost(host_x);
+    } else {
+        float *host_x = x.as(f32).host<float>();
+        mesh = marchingCubes(host_x, dims, iso);
+        af::freeHost(host_x);
+    }
+
+    string ext = filename.substr(filename.find_last_of('.') + 1);
+    if (ext.compare("ply") == 0) {
+        writeMeshPLY(mesh, filename);
+    } else {
+        writeMeshSTL(mesh, filename);
+    }
+}
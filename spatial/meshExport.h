@@ -0,0 +1,34 @@
+/*
+ * meshExport.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef MESHEXPORT_H_
+#define MESHEXPORT_H_
+
+#include <string>
+#include <vector>
+#include <arrayfire.h>
+
+struct triangleMesh {
+    // indexed (welded) triangle mesh
+    std::vector<float> vertices;       // x,y,z per vertex
+    std::vector<unsigned int> triangles; // three vertex ids per triangle
+};
+
+// extract the iso-surface {x = iso} of a column major volume of size
+// dims[0]*dims[1]*dims[2] with marching cubes, in parallel slabs. Voxels
+// outside the volume count as empty so the surface is always closed.
+triangleMesh marchingCubes(const float *data, const long dims[3], float iso);
+triangleMesh marchingCubes(const unsigned char *data, const long dims[3],
+        float iso);
+
+void writeMeshSTL(const triangleMesh &mesh, std::string filename);
+void writeMeshPLY(const triangleMesh &mesh, std::string filename);
+
+// write the iso-surface of an arrayfire volume straight to disk, as binary
+// stl or, when the filename ends in .ply, as an indexed binary ply.
+void exportIsosurface(af::array x, std::string filename, float iso = 0.5);
+
+#endif /* MESHEXPORT_H_ */
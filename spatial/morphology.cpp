@@ -0,0 +1,259 @@
+/*
+ * morphology.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+
+#include "morphology.h"
+
+static const float DT_INF = 1e20f;
+
+static void lineShape(af::dim4 dims, int axis, long &len, long &inner,
+        long &outer) {
+    // the volume as [outer][len][inner], inner being contiguous
+    len = dims[axis];
+    inner = 1;
+    outer = 1;
+    for (int a = 0; a < axis; a++)
+        inner *= dims[a];
+    for (int a = axis + 1; a < 3; a++)
+        outer *= dims[a];
+}
+
+static void runningFilter(std::vector<unsigned char> &v, af::dim4 dims,
+        int axis, int lo, int hi, bool isMax) {
+    /*
+     * van Herk/Gil-Werman: out[i] = op(v[i-lo .. i+hi]) along an axis. The
+     * line is padded with background and cut into blocks of the window size
+     * k; g is the running op from the start of each block, h from its end,
+     * and any window is covered by the tail of one block and the head of the
+     * next, op(h[i], g[i+k-1]). Lines are processed in chunks of adjacent
+     * lines, so the inner loops run over contiguous memory.
+     */
+    int k = lo + hi + 1;
+    if (k <= 1)
+        return;
+    long len, inner, outer;
+    lineShape(dims, axis, len, inner, outer);
+    long m = len + lo + hi; // padded length
+    const long B = 1024;    // lines per chunk
+    long chunks = (inner + B - 1) / B;
+
+#pragma omp parallel
+    {
+        std::vector<unsigned char> g, h;
+#pragma omp for schedule(dynamic)
+        for (long task = 0; task < outer * chunks; task++) {
+            long o = task / chunks;
+            long b0 = (task % chunks) * B;
+            long w = std::min(B, inner - b0);
+            unsigned char *base = &v[o * len * inner + b0];
+            g.resize(m * w);
+            h.resize(m * w);
+            for (long t = 0; t < m; t++) {
+                long i = t - lo;
+                unsigned char *gt = &g[t * w];
+                if (i < 0 || i >= len) {
+                    std::fill(gt, gt + w, 0);
+                } else {
+                    std::copy(base + i * inner, base + i * inner + w, gt);
+                }
+                if (t % k != 0) {
+                    const unsigned char *gp = gt - w;
+                    for (long c = 0; c < w; c++)
+                        gt[c] = isMax ? std::max(gt[c], gp[c]) : std::min(gt[c], gp[c]);
+                }
+            }
+            for (long t = m - 1; t >= 0; t--) {
+                long i = t - lo;
+                unsigned char *ht = &h[t * w];
+                if (i < 0 || i >= len) {
+                    std::fill(ht, ht + w, 0);
+                } else {
+                    std::copy(base + i * inner, base + i * inner + w, ht);
+                }
+                if (t % k != k - 1 && t != m - 1) {
+                    const unsigned char *hn = ht + w;
+                    for (long c = 0; c < w; c++)
+                        ht[c] = isMax ? std::max(ht[c], hn[c]) : std::min(ht[c], hn[c]);
+                }
+            }
+            for (long i = 0; i < len; i++) {
+                const unsigned char *hi_ = &h[i * w];
+                const unsigned char *gi = &g[(i + k - 1) * w];
+                unsigned char *out = base + i * inner;
+                for (long c = 0; c < w; c++)
+                    out[c] = isMax ? std::max(hi_[c], gi[c]) : std::min(hi_[c], gi[c]);
+            }
+        }
+    }
+}
+
+static bitVolume boxFilter(const bitVolume &x, int k0, int k1, int k2,
+        bool isMax) {
+    std::vector<unsigned char> v;
+    x.unpack(v);
+    int k[3] = { k0, k1, k2 };
+    for (int axis = 0; axis < 3; axis++) {
+        // erosion covers -(k/2) .. (k-1)/2, dilation the reflection
+        int lo = k[axis] / 2, hi = (k[axis] - 1) / 2;
+        if (isMax)
+            std::swap(lo, hi);
+        runningFilter(v, x.dims(), axis, lo, hi, isMax);
+    }
+    return bitVolume(x.dims(), v);
+}
+
+bitVolume boxDilate(const bitVolume &x, int k0, int k1, int k2) {
+    return boxFilter(x, k0, k1, k2, true);
+}
+
+bitVolume boxErode(const bitVolume &x, int k0, int k1, int k2) {
+    return boxFilter(x, k0, k1, k2, false);
+}
+
+bitVolume boxOpen(const bitVolume &x, int k0, int k1, int k2) {
+    return boxDilate(boxErode(x, k0, k1, k2), k0, k1, k2);
+}
+
+bitVolume boxClose(const bitVolume &x, int k0, int k1, int k2) {
+    return boxErode(boxDilate(x, k0, k1, k2), k0, k1, k2);
+}
+
+static void distanceLine(const float *f, float *d, int *v, float *z, long n) {
+    // 1d squared distance transform of the sampled function f
+    // (Felzenszwalb and Huttenlocher, lower envelope of parabolas)
+    long k = 0;
+    long first = 0;
+    while (first < n && f[first] >= DT_INF)
+        first++;
+    if (first == n) {
+        std::fill(d, d + n, DT_INF);
+        return;
+    }
+    v[0] = static_cast<int>(first);
+    z[0] = -DT_INF;
+    z[1] = DT_INF;
+    for (long q = first + 1; q < n; q++) {
+        if (f[q] >= DT_INF)
+            continue;
+        // drop the parabolas hidden by the one at q; z[0] is -inf, so at
+        // least one stays
+        float s;
+        while (true) {
+            long p = v[k];
+            s = ((f[q] + q * q) - (f[p] + p * p)) / (2.f * (q - p));
+            if (s > z[k])
+                break;
+            k--;
+        }
+        k++;
+        v[k] = static_cast<int>(q);
+        z[k] = s;
+        z[k + 1] = DT_INF;
+    }
+    k = 0;
+    for (long q = 0; q < n; q++) {
+        while (z[k + 1] < q)
+            k++;
+        float dq = static_cast<float>(q - v[k]);
+        d[q] = dq * dq + f[v[k]];
+    }
+}
+
+std::vector<float> squaredDistanceTransform(const bitVolume &x) {
+    long n = x.size();
+    std::vector<float> d(n);
+#pragma omp parallel for
+    for (long i = 0; i < n; i++)
+        d[i] = x.test(i) ? 0.f : DT_INF;
+
+    af::dim4 dims = x.dims();
+    for (int axis = 0; axis < 3; axis++) {
+        long len, inner, outer;
+        lineShape(dims, axis, len, inner, outer);
+        if (len <= 1)
+            continue;
+#pragma omp parallel
+        {
+            std::vector<float> f(len), out(len), z(len + 1);
+            std::vector<int> v(len);
+#pragma omp for schedule(dynamic, 64)
+            for (long line = 0; line < outer * inner; line++) {
+                float *base = &d[(line / inner) * len * inner + line % inner];
+                for (long i = 0; i < len; i++)
+                    f[i] = base[i * inner];
+                distanceLine(&f[0], &out[0], &v[0], &z[0], len);
+                for (long i = 0; i < len; i++)
+                    base[i * inner] = std::min(out[i], DT_INF);
+            }
+        }
+    }
+    return d;
+}
+
+bitVolume ballDilate(const bitVolume &x, double radius) {
+    std::vector<float> d = squaredDistanceTransform(x);
+    float r2 = static_cast<float>(radius * radius);
+    std::vector<unsigned char> v(d.size());
+#pragma omp parallel for
+    for (long i = 0; i < static_cast<long>(d.size()); i++)
+        v[i] = d[i] <= r2;
+    return bitVolume(x.dims(), v);
+}
+
+bitVolume ballErode(const bitVolume &x, double radius) {
+    // keep the voxels farther than radius from the background, which
+    // includes everything outside the grid
+    std::vector<unsigned char> v;
+    x.unpack(v);
+#pragma omp parallel for
+    for (long i = 0; i < static_cast<long>(v.size()); i++)
+        v[i] = !v[i];
+    std::vector<float> d = squaredDistanceTransform(bitVolume(x.dims(), v));
+
+    af::dim4 dims = x.dims();
+    float r2 = static_cast<float>(radius * radius);
+    long n0 = dims[0], n1 = dims[1], n2 = dims[2];
+    // axes past the image dimensionality (trailing singleton axes, as in
+    // af::array::numdims) have no border; a thin axis inside it does
+    int used = static_cast<int>(dims.ndims());
+#pragma omp parallel for
+    for (long i = 0; i < static_cast<long>(d.size()); i++) {
+        long c[3] = { i % n0, (i / n0) % n1, i / (n0 * n1) };
+        long n[3] = { n0, n1, n2 };
+        float border = d[i];
+        for (int a = 0; a < used && a < 3; a++) {
+            float e = static_cast<float>(std::min(c[a] + 1, n[a] - c[a]));
+            border = std::min(border, e * e);
+        }
+        v[i] = x.test(i) && border > r2;
+    }
+    return bitVolume(x.dims(), v);
+}
+
+bitVolume ballOpen(const bitVolume &x, double radius) {
+    return ballDilate(ballErode(x, radius), radius);
+}
+
+bitVolume ballClose(const bitVolume &x, double radius) {
+    return ballErode(ballDilate(x, radius), radius);
+}
+
+af::array boxDilate(af::array x, int k0, int k1, int k2) {
+    return boxDilate(bitVolume(x), k0, k1, k2).toArray().as(x.type());
+}
+
+af::array boxErode(af::array x, int k0, int k1, int k2) {
+    return boxErode(bitVolume(x), k0, k1, k2).toArray().as(x.type());
+}
+
+af::array ballDilate(af::array x, double radius) {
+    return ballDilate(bitVolume(x), radius).toArray().as(x.type());
+}
+
+af::array ballErode(af::array x, double radius) {
+    return ballErode(bitVolume(x), radius).toArray().as(x.type());
+}
@@ -0,0 +1,49 @@
+/*
+ * morphology.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef MORPHOLOGY_H_
+#define MORPHOLOGY_H_
+
+#include <vector>
+#include <arrayfire.h>
+
+#include "bitVolume.h"
+
+/*
+ * Binary morphology on the host whose cost does not depend on the kernel
+ * size. Box kernels are separable and every axis is filtered with the van
+ * Herk/Gil-Werman running max (min), three comparisons per voxel. Ball
+ * kernels threshold an exact Euclidean distance transform (Felzenszwalb and
+ * Huttenlocher), linear in the number of voxels. All passes run over lines
+ * in parallel.
+ *
+ * Voxels outside the grid are background, so erosion shrinks sets that
+ * touch the border. A box of size k covers offsets -(k/2) .. (k-1)/2 when
+ * eroding and the reflected range when dilating, so opening and closing are
+ * exact for even sizes as well. Use size 1 along unused axes (2d images).
+ */
+
+bitVolume boxDilate(const bitVolume &x, int k0, int k1, int k2);
+bitVolume boxErode(const bitVolume &x, int k0, int k1, int k2);
+bitVolume boxOpen(const bitVolume &x, int k0, int k1, int k2);
+bitVolume boxClose(const bitVolume &x, int k0, int k1, int k2);
+
+// squared Euclidean distance (in voxels) of every voxel to the nearest set
+// voxel of x, a large value if x is empty
+std::vector<float> squaredDistanceTransform(const bitVolume &x);
+
+bitVolume ballDilate(const bitVolume &x, double radius);
+bitVolume ballErode(const bitVolume &x, double radius);
+bitVolume ballOpen(const bitVolume &x, double radius);
+bitVolume ballClose(const bitVolume &x, double radius);
+
+// the same on the support of device arrays, the result has the type of x
+af::array boxDilate(af::array x, int k0, int k1, int k2);
+af::array boxErode(af::array x, int k0, int k1, int k2);
+af::array ballDilate(af::array x, double radius);
+af::array ballErode(af::array x, double radius);
+
+#endif /* MORPHOLOGY_H_ */
@@ -0,0 +1,126 @@
+/*
+ * renderQueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderQueue.h"
+
+using namespace std;
+
+static renderMode modeFromEnvironment() {
+    const char *env = getenv("IMSENSE_RENDER");
+    if (env == NULL)
+        return RENDER_INTERACTIVE;
+    if (strcmp(env, "offscreen") == 0)
+        return RENDER_OFFSCREEN;
+    if (strcmp(env, "none") == 0)
+        return RENDER_NONE;
+    if (strcmp(env, "interactive") != 0)
+        cout << "Unknown IMSENSE_RENDER value " << env
+                << ", rendering interactively" << endl;
+    return RENDER_INTERACTIVE;
+}
+
+static renderMode currentMode = modeFromEnvironment();
+
+void setRenderMode(renderMode mode) {
+    currentMode = mode;
+}
+
+renderMode getRenderMode() {
+    return currentMode;
+}
+
+class renderWorker {
+    // a single background thread running render jobs in submission order,
+    // so the compute loop only pays for the host copy of what it renders
+public:
+    renderWorker() :
+            pending(0), stop(false), worker(&renderWorker::run, this) {
+    }
+
+    ~renderWorker() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+        }
+        cv.notify_all();
+        worker.join(); // finishes the queue first
+    }
+
+    void push(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            jobs.push_back(job);
+            pending++;
+        }
+        cv.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(m);
+        done.wait(lock, [this] {return pending == 0;});
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this] {return stop || !jobs.empty();});
+                if (jobs.empty())
+                    return;
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            job();
+            {
+                std::lock_guard<std::mutex> lock(m);
+                pending--;
+            }
+            done.notify_all();
+        }
+    }
+
+    std::deque<std::function<void()> > jobs;
+    int pending;
+    bool stop;
+    std::mutex m;
+    std::condition_variable cv, done;
+    std::thread worker;
+};
+
+static renderWorker &getWorker() {
+    static renderWorker worker; // started on first use
+    return worker;
+}
+
+void enqueueRender(std::function<void()> job) {
+    getWorker().push(job);
+}
+
+void waitForRenders() {
+    getWorker().wait();
+}
+
+string nextRenderFilename(string prefix) {
+    static std::mutex m;
+    static int counter = 0;
+    std::lock_guard<std::mutex> lock(m);
+    std::stringstream filename;
+    filename << prefix << std::setw(4) << std::setfill('0') << ++counter
+            << ".png";
+    return filename.str();
+}
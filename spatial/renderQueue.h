@@ -0,0 +1,32 @@
+/*
+ * renderQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+
+#include <functional>
+#include <string>
+
+enum renderMode {
+    RENDER_INTERACTIVE, // open a window and block until it is closed
+    RENDER_OFFSCREEN,   // render to numbered png files on a background thread
+    RENDER_NONE         // skip rendering entirely
+};
+
+// The mode defaults to the IMSENSE_RENDER environment variable
+// (interactive, offscreen or none) and to interactive if it is not set.
+void setRenderMode(renderMode mode);
+renderMode getRenderMode();
+
+// run a render job on the background render thread, jobs run in order
+void enqueueRender(std::function<void()> job);
+// block until every queued render job has finished
+void waitForRenders();
+
+// prefix0001.png, prefix0002.png, ... one counter per process
+std::string nextRenderFilename(std::string prefix);
+
+#endif /* RENDERQUEUE_H_ */
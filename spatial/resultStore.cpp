@@ -0,0 +1,66 @@
+/*
+ * resultStore.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "resultStore.h"
+#include "contentHash.h"
+
+volumeCache &resultStoreCache() {
+    static volumeCache *cache = NULL;
+    if (cache == NULL) {
+        const char *dir = getenv("IMSENSE_RESULT_STORE");
+        const char *mb = getenv("IMSENSE_RESULT_STORE_MB");
+        size_t maxBytes = static_cast<size_t>(mb ? atol(mb) : 16384) << 20;
+        cache = new volumeCache(dir ? dir : "", maxBytes);
+    }
+    return *cache;
+}
+
+static bool storeMasks() {
+    const char *env = getenv("IMSENSE_RESULT_STORE_MASKS");
+    return env == NULL || strcmp(env, "0") != 0;
+}
+
+uint64_t sweepKey(const af::array &part, const af::array &tool,
+        double threshold, af::dtype precision, std::string kind) {
+    uint64_t h = fnv1a(kind.c_str(), kind.size());
+    h = hashArray(part, h);
+    h = hashArray(tool, h);
+    h = hashValue(threshold, h);
+    return hashValue(static_cast<int>(precision), h);
+}
+
+uint64_t orientationKey(uint64_t base, const double *R) {
+    return hashRotation(R, hashValue(base, fnv1a("orientation", 11)));
+}
+
+uint64_t sweepResultKey(uint64_t base, const std::vector<uint64_t> &orientations) {
+    uint64_t h = hashValue(base, fnv1a("sweep", 5));
+    for (size_t i = 0; i < orientations.size(); i++)
+        h = hashValue(orientations[i], h);
+    return h;
+}
+
+uint64_t sweepResultKey(uint64_t base, const std::vector<int> &parameters) {
+    uint64_t h = hashValue(base, fnv1a("parameters", 10));
+    for (size_t i = 0; i < parameters.size(); i++)
+        h = hashValue(parameters[i], h);
+    return h;
+}
+
+af::array storedOrientation(uint64_t key, std::function<af::array()> evaluate) {
+    volumeCache &cache = resultStoreCache();
+    af::array f;
+    if (cache.lookup(key, f))
+        return f;
+    // indicators are stored as b8, a quarter of the f32 size
+    f = evaluate() > 0;
+    if (storeMasks())
+        cache.store(key, f);
+    return f;
+}
@@ -0,0 +1,51 @@
+/*
+ * resultStore.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef RESULTSTORE_H_
+#define RESULTSTORE_H_
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <arrayfire.h>
+
+#include "volumeCache.h"
+
+/*
+ * Content addressed store of orientation sweep results across runs. A sweep
+ * is identified by a base key (part, tool, thresholds, precision and the
+ * kind of sweep, see sweepKey) and its orientations by rotation keys. The
+ * store holds the final accumulator of every completed sweep and,
+ * optionally, the indicator of every orientation, so a later sweep over a
+ * superset of the orientations only evaluates the new ones.
+ *
+ * Completed sweeps are looked up and stored with resultStoreCache() under
+ * sweepResultKey, single orientations through storedOrientation.
+ *
+ * The store lives in the directory given by IMSENSE_RESULT_STORE, limited
+ * to IMSENSE_RESULT_STORE_MB megabytes (default 16384), and is disabled if
+ * the variable is not set. IMSENSE_RESULT_STORE_MASKS=0 skips the per
+ * orientation indicators.
+ */
+volumeCache &resultStoreCache();
+
+// base key of a sweep
+uint64_t sweepKey(const af::array &part, const af::array &tool,
+        double threshold, af::dtype precision, std::string kind);
+
+// key of one orientation of a sweep, from its rotation matrix
+uint64_t orientationKey(uint64_t base, const double *R);
+
+// key of a sweep over a list of orientations, or over a parameterised set
+uint64_t sweepResultKey(uint64_t base, const std::vector<uint64_t> &orientations);
+uint64_t sweepResultKey(uint64_t base, const std::vector<int> &parameters);
+
+// indicator (b8) of one orientation from the store, evaluated and stored on
+// a miss
+af::array storedOrientation(uint64_t key, std::function<af::array()> evaluate);
+
+#endif /* RESULTSTORE_H_ */
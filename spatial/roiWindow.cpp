@@ -0,0 +1,88 @@
+/*
+ * roiWindow.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+
+#include "roiWindow.h"
+
+using namespace af;
+
+long roiWindow::fraction() const {
+    double inside = 1, total = 1;
+    for (int a = 0; a < 3; a++) {
+        inside *= std::max(0L, hi[a] - lo[a] + 1);
+        total *= dims[a];
+    }
+    return static_cast<long>(100 * inside / total);
+}
+
+roiWindow roiWindowFor(array roi, dim4 toolDims) {
+    roiWindow w;
+    dim4 d = roi.dims();
+    w.dims = d;
+    w.full = true;
+    for (int a = 0; a < 3; a++) {
+        w.lo[a] = w.inLo[a] = 0;
+        w.hi[a] = w.inHi[a] = d[a] - 1;
+    }
+    if (roi.isempty())
+        return w;
+
+    array mask = roi > 0;
+    // extent along each axis from the projection onto it
+    array profile[3] = { anyTrue(anyTrue(mask, 1), 2), anyTrue(anyTrue(mask, 0), 2),
+            anyTrue(anyTrue(mask, 0), 1) };
+    for (int a = 0; a < 3; a++) {
+        if (d[a] == 1)
+            continue; // unused axis of an image
+        array idx = where(flat(profile[a]));
+        if (idx.isempty()) {
+            // nothing of interest, an empty inner box
+            w.full = false;
+            w.inLo[a] = 0;
+            w.inHi[a] = -1;
+            continue;
+        }
+        w.inLo[a] = min<unsigned>(idx);
+        w.inHi[a] = max<unsigned>(idx);
+        // any placement of the tool inside the box only reads voxels within
+        // a tool length of it
+        long margin = toolDims[a];
+        w.lo[a] = std::max(0L, w.inLo[a] - margin);
+        w.hi[a] = std::min<long>(d[a] - 1, w.inHi[a] + margin);
+        if (w.lo[a] > 0 || w.hi[a] < d[a] - 1)
+            w.full = false;
+    }
+    return w;
+}
+
+static seq windowSeq(long lo, long hi) {
+    return seq(static_cast<double>(lo), static_cast<double>(hi));
+}
+
+array cropToWindow(array x, const roiWindow &w) {
+    if (w.full)
+        return x;
+    return x(windowSeq(w.lo[0], w.hi[0]), windowSeq(w.lo[1], w.hi[1]),
+            windowSeq(w.lo[2], w.hi[2]));
+}
+
+array expandFromWindow(array cropped, const roiWindow &w) {
+    if (w.full)
+        return cropped;
+    array result = constant(0, w.dims, cropped.type());
+    for (int a = 0; a < 3; a++) {
+        if (w.inHi[a] < w.inLo[a])
+            return result; // empty roi
+    }
+    // the inner box, in crop and in grid coordinates
+    result(windowSeq(w.inLo[0], w.inHi[0]), windowSeq(w.inLo[1], w.inHi[1]),
+            windowSeq(w.inLo[2], w.inHi[2])) = cropped(
+            windowSeq(w.inLo[0] - w.lo[0], w.inHi[0] - w.lo[0]),
+            windowSeq(w.inLo[1] - w.lo[1], w.inHi[1] - w.lo[1]),
+            windowSeq(w.inLo[2] - w.lo[2], w.inHi[2] - w.lo[2]));
+    return result;
+}
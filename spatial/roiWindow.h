@@ -0,0 +1,38 @@
+/*
+ * roiWindow.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef ROIWINDOW_H_
+#define ROIWINDOW_H_
+
+#include <arrayfire.h>
+
+struct roiWindow {
+    /*
+     * Sub-volume a correlation has to see to be exact inside a region of
+     * interest: the bounding box of the roi (inner), grown by the tool size
+     * on every side (outer), clipped to the grid. Correlating the outer crop
+     * gives the full-grid values everywhere in the inner box.
+     */
+    bool full;          // no roi, or the window covers the grid
+    long lo[3], hi[3];  // outer window, inclusive
+    long inLo[3], inHi[3]; // inner box, inclusive
+    af::dim4 dims;      // full grid dims
+
+    long fraction() const; // percentage of the grid in the outer window
+};
+
+// window of an roi (any nonzero voxel) for a tool of size toolDims; an
+// empty roi gives the full grid, an roi without voxels an empty inner box
+roiWindow roiWindowFor(af::array roi, af::dim4 toolDims);
+
+// the outer crop of a full size array
+af::array cropToWindow(af::array x, const roiWindow &w);
+
+// a full size array, zero outside the inner box, from a result computed on
+// the outer crop
+af::array expandFromWindow(af::array cropped, const roiWindow &w);
+
+#endif /* ROIWINDOW_H_ */
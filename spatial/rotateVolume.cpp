@@ -0,0 +1,71 @@
+/*
+ * rotateVolume.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "rotateVolume.h"
+
+using namespace af;
+
+array rotateVolume(array x, const Eigen::Matrix3d &R) {
+    // arrayfire only rotates images, so rotate volumes by pulling every
+    // output voxel back through the inverse rotation R^T and gathering
+    dim4 d = x.dims();
+    float c0 = (d[0] - 1) / 2.f, c1 = (d[1] - 1) / 2.f, c2 = (d[2] - 1) / 2.f;
+    array i = range(d, 0, f32) - c0;
+    array j = range(d, 1, f32) - c1;
+    array k = range(d, 2, f32) - c2;
+
+    array s0 = round(R(0, 0) * i + R(1, 0) * j + R(2, 0) * k + c0);
+    array s1 = round(R(0, 1) * i + R(1, 1) * j + R(2, 1) * k + c1);
+    array s2 = round(R(0, 2) * i + R(1, 2) * j + R(2, 2) * k + c2);
+
+    array inside = (s0 >= 0) && (s0 <= d[0] - 1) && (s1 >= 0)
+            && (s1 <= d[1] - 1) && (s2 >= 0) && (s2 <= d[2] - 1);
+    // out of range voxels gather element 0 and are masked out afterwards.
+    // The linear index is built in u32, f32 is not exact beyond 2^24.
+    unsigned n0 = static_cast<unsigned>(d[0]), n1 = static_cast<unsigned>(d[1]);
+    array index = (s0 * inside).as(u32)
+            + n0 * ((s1 * inside).as(u32) + n1 * (s2 * inside).as(u32));
+    array rotated = moddims(x(flat(index)), d) * inside.as(x.type());
+    return rotated;
+}
+
+array padForRotation(array x) {
+    // pad about the center until every axis spans the circle (or sphere)
+    // around the center that holds all set voxels, with a margin for the
+    // voxels' own extent and the interpolation. Rotating inside the padded
+    // grid then loses nothing. Axes grow by an even amount, so the center
+    // voxel (dims / 2, as the correlations use it) stays the center.
+    array idx = af::where(x != 0);
+    if (idx.isempty())
+        return x;
+    dim4 d = x.dims();
+    array i = idx.as(f64);
+    array x0 = af::mod(i, d[0]) - (d[0] - 1) / 2.0;
+    array x1 = af::mod(af::floor(i / d[0]), d[1]) - (d[1] - 1) / 2.0;
+    array x2 = af::floor(i / (d[0] * d[1])) - (d[2] - 1) / 2.0;
+    double radius = std::sqrt(af::max<double>(x0 * x0 + x1 * x1 + x2 * x2));
+    int side = static_cast<int>(std::ceil(2 * radius)) + 3;
+
+    dim4 padded = d;
+    int lo[3] = { 0, 0, 0 };
+    bool grow = false;
+    for (int a = 0; a < static_cast<int>(x.numdims()) && a < 3; a++) {
+        int extra = std::max(0, side - static_cast<int>(d[a]));
+        extra += extra % 2;
+        padded[a] = d[a] + extra;
+        lo[a] = extra / 2;
+        grow = grow || (extra > 0);
+    }
+    if (!grow)
+        return x;
+    array out = af::constant(0, padded, x.type());
+    out(af::seq(lo[0], lo[0] + d[0] - 1), af::seq(lo[1], lo[1] + d[1] - 1),
+            af::seq(lo[2], lo[2] + d[2] - 1)) = x;
+    return out;
+}
@@ -0,0 +1,23 @@
+/*
+ * rotateVolume.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef ROTATEVOLUME_H_
+#define ROTATEVOLUME_H_
+
+#include <arrayfire.h>
+#include <Eigen/Geometry>
+#include <Eigen/Dense>
+
+// rotate a volume about its center by R, acting on the array axes
+// (dim 0, dim 1, dim 2). The output has the size of the input and uses
+// nearest neighbour sampling, which keeps indicator functions binary.
+af::array rotateVolume(af::array x, const Eigen::Matrix3d &R);
+
+// x (2d or 3d) zero padded about its center so that rotating it inside its
+// own grid, by rotateVolume or af::rotate, crops none of its set voxels
+af::array padForRotation(af::array x);
+
+#endif /* ROTATEVOLUME_H_ */
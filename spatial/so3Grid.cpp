@@ -0,0 +1,187 @@
+/*
+ * so3Grid.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <cmath>
+#include <iostream>
+#include <stdlib.h>
+
+#include "so3Grid.h"
+
+using namespace std;
+
+Eigen::Matrix3d so3Grid::rotation(int i) const {
+    Eigen::Matrix3d m;
+    for (int k = 0; k < 9; k++)
+        m(k / 3, k % 3) = r[k][i];
+    return m;
+}
+
+std::vector<double> gridS1(int level) {
+    // evenly spaced angles, offset by half an interval so that every point of
+    // a level has two children at the next level (grid_s1.C)
+    int npoints = 6 * (1 << level);
+    double interval = 2 * M_PI / npoints;
+    std::vector<double> points(npoints);
+    for (int i = 0; i < npoints; i++)
+        points[i] = interval / 2 + i * interval;
+    return points;
+}
+
+struct pix2xyTable {
+    // x and y in the face from the last 10 bits of a nested pixel number,
+    // the bits of x and y are interleaved in the pixel number (mk_pix2xy.c)
+    int x[1024], y[1024];
+    pix2xyTable() {
+        for (int kpix = 0; kpix < 1024; kpix++) {
+            int ix = 0, iy = 0;
+            for (int bit = 0; bit < 5; bit++) {
+                ix |= ((kpix >> (2 * bit)) & 1) << bit;
+                iy |= ((kpix >> (2 * bit + 1)) & 1) << bit;
+            }
+            x[kpix] = ix;
+            y[kpix] = iy;
+        }
+    }
+};
+
+void healpixPix2AngNest(long nside, long ipix, double *theta, double *phi) {
+    // theta and phi of the center of pixel ipix in the NESTED scheme
+    // (pix2ang_nest.c from the HEALPix distribution)
+    static const pix2xyTable pix2xy;
+    // coordinate of the lowest corner of each face, jrll in units of nside
+    // and jpll in units of nside/2
+    static const int jrll[12] = { 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4 };
+    static const int jpll[12] = { 1, 3, 5, 7, 0, 2, 4, 6, 1, 3, 5, 7 };
+
+    if (nside < 1 || nside > 8192) {
+        cout << "nside out of range: " << nside << endl;
+        exit(1);
+    }
+    long npface = nside * nside;
+    if (ipix < 0 || ipix >= 12 * npface) {
+        cout << "ipix out of range: " << ipix << endl;
+        exit(1);
+    }
+
+    // the face, and the pixel number in the face
+    long face = ipix / npface;
+    long ipf = ipix % npface;
+
+    // x,y on the face from the pixel number, 10 bits at a time
+    long ix = 1024 * pix2xy.x[(ipf >> 20) & 1023]
+            + 32 * pix2xy.x[(ipf >> 10) & 1023] + pix2xy.x[ipf & 1023];
+    long iy = 1024 * pix2xy.y[(ipf >> 20) & 1023]
+            + 32 * pix2xy.y[(ipf >> 10) & 1023] + pix2xy.y[ipf & 1023];
+
+    // (horizontal, vertical) coordinates
+    long jrt = ix + iy;
+    long jpt = ix - iy;
+
+    // ring number in {1, 4*nside-1}
+    long jr = jrll[face] * nside - jrt - 1;
+    long nl4 = 4 * nside;
+    double fn = static_cast<double>(nside);
+    long nr = nside; // equatorial region
+    double z = (2 * nside - jr) * 2. / (3. * fn);
+    long kshift = (jr - nside) % 2;
+    if (jr < nside) { // north pole region
+        nr = jr;
+        z = 1. - nr * nr / (3. * fn * fn);
+        kshift = 0;
+    } else if (jr > 3 * nside) { // south pole region
+        nr = nl4 - jr;
+        z = -1. + nr * nr / (3. * fn * fn);
+        kshift = 0;
+    }
+    *theta = acos(z);
+
+    // phi number in the ring in {1, 4*nr}
+    long jp = (jpll[face] * nr + jpt + 1 + kshift) / 2;
+    if (jp > nl4)
+        jp -= nl4;
+    if (jp < 1)
+        jp += nl4;
+    *phi = (jp - (kshift + 1) * 0.5) * (0.5 * M_PI / nr);
+}
+
+static void appendLevel(so3Grid &grid, int level) {
+    // Append the points of a level: every HEALPix pixel center (theta, phi) with
+    // every S^1 angle psi, mapped to a quaternion by the Hopf fibration
+    // (simple_grid.C, hopf2quat.C). Points are ordered pixel major so the
+    // children of a point are easy to find.
+    std::vector<double> psi = gridS1(level);
+    long nside = 1L << level;
+    long npixels = 12 * nside * nside;
+    int npsi = static_cast<int>(psi.size());
+    size_t start = grid.qw.size();
+    size_t n = start + npixels * npsi;
+
+    grid.qw.resize(n);
+    grid.qx.resize(n);
+    grid.qy.resize(n);
+    grid.qz.resize(n);
+    for (int k = 0; k < 9; k++)
+        grid.r[k].resize(n);
+
+#pragma omp parallel for
+    for (long p = 0; p < npixels; p++) {
+        double theta, phi;
+        healpixPix2AngNest(nside, p, &theta, &phi);
+        for (int j = 0; j < npsi; j++) {
+            size_t i = start + p * npsi + j;
+            double w = cos(theta / 2) * cos(psi[j] / 2);
+            double x = cos(theta / 2) * sin(psi[j] / 2);
+            double y = sin(theta / 2) * cos(phi + psi[j] / 2);
+            double z = sin(theta / 2) * sin(phi + psi[j] / 2);
+            grid.qw[i] = w;
+            grid.qx[i] = x;
+            grid.qy[i] = y;
+            grid.qz[i] = z;
+            // rotation matrix of the unit quaternion
+            grid.r[0][i] = 1 - 2 * (y * y + z * z);
+            grid.r[1][i] = 2 * (x * y - z * w);
+            grid.r[2][i] = 2 * (x * z + y * w);
+            grid.r[3][i] = 2 * (x * y + z * w);
+            grid.r[4][i] = 1 - 2 * (x * x + z * z);
+            grid.r[5][i] = 2 * (y * z - x * w);
+            grid.r[6][i] = 2 * (x * z - y * w);
+            grid.r[7][i] = 2 * (y * z + x * w);
+            grid.r[8][i] = 1 - 2 * (x * x + y * y);
+        }
+    }
+    grid.levelStart.push_back(static_cast<int>(n));
+}
+
+void addSO3Level(so3Grid &grid) {
+    appendLevel(grid, grid.levels());
+}
+
+so3Grid simpleSO3Grid(int level) {
+    // only the points of one level
+    so3Grid grid;
+    appendLevel(grid, level);
+    return grid;
+}
+
+so3Grid layeredSO3Grid(int level) {
+    so3Grid grid;
+    for (int l = 0; l <= level; l++)
+        addSO3Level(grid);
+    return grid;
+}
+
+std::vector<int> so3Children(int level, int index) {
+    int npsi = 6 * (1 << level);
+    int pixel = index / npsi;
+    int j = index % npsi;
+    std::vector<int> children;
+    for (int p = 0; p < 4; p++) {
+        for (int h = 0; h < 2; h++) {
+            children.push_back((4 * pixel + p) * (2 * npsi) + 2 * j + h);
+        }
+    }
+    return children;
+}
@@ -0,0 +1,66 @@
+/*
+ * so3Grid.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SO3GRID_H_
+#define SO3GRID_H_
+
+#include <vector>
+#include <Eigen/Geometry>
+#include <Eigen/Dense>
+
+/*
+ * In memory version of the ISOI generator in rotations/SO3_grid (Yershova,
+ * Jain, LaValle, Mitchell). Level l of the grid has 12*4^l HEALPix points on
+ * S^2 times 6*2^l points on S^1, i.e. 72 rotations at level 0 and 576 at
+ * level 1 (the old 72quaternions.dat and 576quaternions.dat).
+ *
+ * Rotations are stored as a structure of arrays so loops over the whole set
+ * vectorize. Levels are appended one at a time, so growing a grid only
+ * computes the new points.
+ */
+struct so3Grid {
+    // unit quaternions
+    std::vector<double> qw, qx, qy, qz;
+    // rotation matrices, r[3*i+j] holds entry (i,j) of every rotation
+    std::vector<double> r[9];
+    // the points of level l are [levelStart[l], levelStart[l+1])
+    std::vector<int> levelStart;
+
+    so3Grid() :
+            levelStart(1, 0) {
+    }
+    int size() const {
+        return static_cast<int>(qw.size());
+    }
+    int levels() const {
+        return static_cast<int>(levelStart.size()) - 1;
+    }
+    Eigen::Quaterniond quaternion(int i) const {
+        return Eigen::Quaterniond(qw[i], qx[i], qy[i], qz[i]);
+    }
+    Eigen::Matrix3d rotation(int i) const;
+};
+
+// points on S^1 at a resolution level, 6*2^l evenly spaced angles
+std::vector<double> gridS1(int level);
+
+// HEALPix nested pixel centers (theta, phi) for nside = 2^level
+void healpixPix2AngNest(long nside, long ipix, double *theta, double *phi);
+
+// append the simple grid of the next level to the grid
+void addSO3Level(so3Grid &grid);
+
+// points of a single level (ISOI "simple grid"), stored as level 0 of the
+// returned grid
+so3Grid simpleSO3Grid(int level);
+// all levels 0..level (ISOI "layered grid"), built incrementally
+so3Grid layeredSO3Grid(int level);
+
+// offsets (within level+1) of the 8 children of point index (within level)
+// in the hierarchy: HEALPix pixel p splits into 4p..4p+3, angle j into 2j, 2j+1
+std::vector<int> so3Children(int level, int index);
+
+#endif /* SO3GRID_H_ */
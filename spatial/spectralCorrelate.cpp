@@ -0,0 +1,63 @@
+/*
+ * spectralCorrelate.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "spectralCorrelate.h"
+
+using namespace af;
+
+static bool isVolume(dim4 d) {
+    return d[2] > 1;
+}
+
+long fftSize(long n) {
+    for (long m = (n < 1) ? 1 : n;; m++) {
+        long r = m;
+        const long primes[] = { 2, 3, 5, 7 };
+        for (int p = 0; p < 4; p++) {
+            while (r % primes[p] == 0)
+                r /= primes[p];
+        }
+        if (r == 1)
+            return m;
+    }
+}
+
+dim4 correlationShape(dim4 x, dim4 y) {
+    // the linear correlation needs x + y - 1 along each axis, anything
+    // larger is only padding, so slender grids stay slender
+    dim4 shape(fftSize(x[0] + y[0] - 1), fftSize(x[1] + y[1] - 1), 1, 1);
+    if (isVolume(x) || isVolume(y)) {
+        shape[2] = fftSize(x[2] + y[2] - 1);
+    }
+    return shape;
+}
+
+array spectrum(array x, dim4 shape) {
+    x = x.as(f32);
+    if (shape[2] > 1) {
+        return fft3(x, shape[0], shape[1], shape[2]);
+    }
+    return fft2(x, shape[0], shape[1]);
+}
+
+array correlateSpectra(array xSpectrum, array ySpectrum, dim4 xDims,
+        dim4 yDims) {
+    // c(l) = sum_i x(i + l) y(i) is the circular correlation of the padded
+    // arrays; the padding makes it linear. Placing the center of y at voxel
+    // i of x is c(i - center), so shift by the center and crop to x.
+    array product = xSpectrum * conjg(ySpectrum);
+    bool volume = xSpectrum.dims()[2] > 1;
+    array c = volume ? real(ifft3(product)) : real(ifft2(product));
+    int c0 = static_cast<int>(yDims[0] / 2);
+    int c1 = static_cast<int>(yDims[1] / 2);
+    int c2 = volume ? static_cast<int>(yDims[2] / 2) : 0;
+    c = shift(c, c0, c1, c2);
+    if (volume) {
+        return c(seq(0, xDims[0] - 1), seq(0, xDims[1] - 1),
+                seq(0, xDims[2] - 1));
+    }
+    return c(seq(0, xDims[0] - 1), seq(0, xDims[1] - 1));
+}
@@ -0,0 +1,35 @@
+/*
+ * spectralCorrelate.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef SPECTRALCORRELATE_H_
+#define SPECTRALCORRELATE_H_
+
+#include <arrayfire.h>
+
+/*
+ * Correlation through explicitly formed spectra, so a spectrum that is used
+ * many times (the part) is transformed once and one that is reused across
+ * runs (a rotated tool) can be cached. Works on 2d and 3d arrays.
+ */
+
+// smallest size >= n whose only prime factors are 2, 3, 5 and 7, the sizes
+// the fft runs fastest on
+long fftSize(long n);
+
+// zero padded shape that holds the full linear correlation of x and y, every
+// axis padded on its own to an fft friendly size
+af::dim4 correlationShape(af::dim4 x, af::dim4 y);
+
+// fft of x zero padded to shape
+af::array spectrum(af::array x, af::dim4 shape);
+
+// Overlap of y (reference point at its center voxel, y.dims()/2) placed at
+// every voxel of x, from the spectra of x and y. The result has the dims
+// of x, like convolve with AF_CONV_DEFAULT.
+af::array correlateSpectra(af::array xSpectrum, af::array ySpectrum,
+        af::dim4 xDims, af::dim4 yDims);
+
+#endif /* SPECTRALCORRELATE_H_ */
@@ -6,8 +6,17 @@
  */
 
 #include "ufabRV.h"
+#include "adaptiveSweep.h"
+#include "rotateVolume.h"
+#include "spectralCorrelate.h"
+#include "volumeCache.h"
+#include "contentHash.h"
+#include "resultStore.h"
+#include "morphology.h"
+#include "roiWindow.h"
 
 #include "assert.h"
+#include <iostream>
 
 
 
@@ -63,14 +72,99 @@ array convolveAF(array x, array y, bool correlate){
     }
 }
 
-array maxRV (array x, array y, array infPocket) {
-
-	 // Here x represents the Part, y represents the Tool Assembly, and infPocket represents the toolPlungeVolume at a location
-	//return dilate3(indicator(sublevelComplement(convolve3(x,reflect(y),AF_CONV_EXPAND,AF_CONV_AUTO),1)),infPocket);
-    return indicator(sublevelComplement(convolve3(x,reflect(y),AF_CONV_DEFAULT,AF_CONV_AUTO),1));
+array plungeDilate(array x, array infPocket){
+    // dilate by the box toolPlungeVolume with separable running max passes,
+    // arrayfire's dilate3 cost grows with the mask volume
+    dim4 d = infPocket.dims();
+    return boxDilate(x, d[0], d[1], d[2]);
 }
 
+array maxRV (array x, array y, array infPocket, array roi) {
 
+	 // Here x represents the Part, y represents the Tool Assembly, and infPocket represents the toolPlungeVolume at a location
+    // the reachable positions are dilated by the plunge volume (a box).
+    // With an roi only its bounding box, padded by the tool, is correlated
+    // and the positions outside the box are not reachable.
+    roiWindow window = roiWindowFor(roi, y.dims());
+    array reachable = indicator(sublevelComplement(convolve3(cropToWindow(x, window),
+            reflect(y),AF_CONV_DEFAULT,AF_CONV_AUTO),1));
+    return plungeDilate(expandFromWindow(reachable, window), infPocket);
+}
 
+array maxRVAdaptive(array x, array y, array infPocket, int coarseLevel, int maxLevel,
+        array roi) {
+
+    // union of maxRV over tool orientations, refining the SO(3) grid only
+    // around orientations that still add new voxels. The part is
+    // transformed once; rotated tools (and, if cacheToolSpectra, their
+    // spectra) come from the tool library cache when it is enabled.
+    // Results already in the result store are not recomputed. With an roi
+    // the sweep runs on its padded bounding box, so the transforms shrink
+    // with the roi. The tool is padded once so that its rotations keep
+    // every voxel; the window, the fft shape and the keys all follow the
+    // padded tool.
+    y = padForRotation(y);
+    roiWindow window = roiWindowFor(roi, y.dims());
+    x = cropToWindow(x, window);
+    if (!roi.isempty()) {
+        roi = cropToWindow(roi, window);
+        std::cout << "Correlating " << window.fraction() << "% of the grid" << std::endl;
+    }
+    uint64_t storeKey = resultStoreCache().enabled() ?
+            sweepKey(x, y, 0.5, f32, "maxRV") : 0;
+    uint64_t resultKey = 0;
+    if (storeKey) {
+        int parameters[] = { coarseLevel, maxLevel };
+        resultKey = sweepResultKey(storeKey, std::vector<int>(parameters, parameters + 2));
+        if (!roi.isempty()) {
+            // the roi decides where the sweep refines
+            resultKey = sweepResultKey(resultKey, std::vector<uint64_t>(1, hashArray(roi)));
+        }
+        array stored;
+        if (resultStoreCache().lookup(resultKey, stored)) {
+            std::cout << "Adaptive sweep found in the result store" << std::endl;
+            return plungeDilate(expandFromWindow(stored.as(f32), window), infPocket);
+        }
+    }
 
-
+    orientationHierarchy hierarchy(3);
+    volumeCache &cache = toolLibraryCache();
+    uint64_t toolHash = cache.enabled() ? hashArray(y) : 0;
+    dim4 shape = correlationShape(x.dims(), y.dims());
+    array xSpectrum = spectrum(x, shape);
+    bool spectra = cacheToolSpectra();
+    std::function<array(const Eigen::Matrix3d &)> correlateOrientation =
+            [&](const Eigen::Matrix3d &R) {
+                uint64_t key = rotatedToolKey(toolHash, R.data(), AF_INTERP_NEAREST);
+                std::function<array()> toolSpectrum = [&]() {
+                    array rotated = cache.fetch(key, [&]() {return rotateVolume(y, R);});
+                    return spectrum(rotated, shape);
+                };
+                array ySpectrum = spectra ?
+                        cache.fetch(toolSpectrumKey(key, shape), toolSpectrum) : toolSpectrum();
+                // no overlap with the part, up to fft round off
+                array overlap = correlateSpectra(xSpectrum, ySpectrum, x.dims(), y.dims());
+                return indicator(overlap < 0.5);
+            };
+
+    adaptiveSweepResult sweep = adaptiveSweep(hierarchy, coarseLevel, maxLevel,
+            [&](int level, int index) {
+                Eigen::Matrix3d R = hierarchy.rotation(level, index);
+                if (storeKey) {
+                    return storedOrientation(orientationKey(storeKey, R.data()),
+                            [&]() {return correlateOrientation(R);});
+                }
+                return correlateOrientation(R);
+            }, x.dims(), roi);
+    std::cout << "Adaptive sweep computed " << sweep.evaluations << " correlations";
+    if (cache.enabled()) {
+        std::cout << ", tool cache hits " << cache.hits << " misses " << cache.misses;
+    }
+    std::cout << std::endl;
+    if (storeKey) {
+        resultStoreCache().store(resultKey, sweep.feasible);
+    }
+    // dilation distributes over the union, so the plunge volume is applied
+    // once to the union instead of to every orientation
+    return plungeDilate(expandFromWindow(sweep.feasible.as(f32), window), infPocket);
+}
@@ -16,9 +16,14 @@ using namespace af;
 array indicator(array x);
 array sublevel(array x, double measure);
 array sublevelComplement(array x, double measure);
-array maxRV (array x, array y, array infPocket);
+array plungeDilate(array x, array infPocket);
+// roi restricts the computation to the bounding box of its support (padded
+// by the tool), an empty roi is the whole grid
+array maxRV (array x, array y, array infPocket, array roi = array());
 array toolPlungeVolume(int length, int width, int depth);
 array reflect(array x);
 array convolveAF(array x, array y, bool correlate);
+array maxRVAdaptive(array x, array y, array infPocket, int coarseLevel, int maxLevel,
+        array roi = array());
 
 #endif /* FFTTESTS_H_ */
@@ -0,0 +1,234 @@
+/*
+ * volumeCache.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "volumeCache.h"
+#include "contentHash.h"
+
+using namespace std;
+
+// entry layout: header followed by the raw array in arrayfire order
+struct volumeHeader {
+    char magic[4]; // "IMVC"
+    int version;
+    uint64_t key;
+    long long dims[4];
+    int type;
+    int pad;
+    uint64_t bytes;
+};
+
+static const int VOLUME_CACHE_VERSION = 1;
+
+volumeCache::volumeCache(std::string directory, size_t maxBytes) :
+        hits(0), misses(0), directory(directory), maxBytes(maxBytes),
+        totalBytes(0), scanned(false) {
+    if (enabled()) {
+        mkdir(directory.c_str(), 0755); // fine if it already exists
+    }
+}
+
+std::string volumeCache::entryPath(uint64_t key) const {
+    return directory + "/" + hashString(key) + ".vol";
+}
+
+static af::array arrayFromHost(const volumeHeader &h, const void *data) {
+    af::dim4 d(h.dims[0], h.dims[1], h.dims[2], h.dims[3]);
+    switch (h.type) {
+    case f32:
+        return af::array(d, static_cast<const float *>(data));
+    case f64:
+        return af::array(d, static_cast<const double *>(data));
+    case c32:
+        return af::array(d, static_cast<const af::cfloat *>(data));
+    case c64:
+        return af::array(d, static_cast<const af::cdouble *>(data));
+    case u8:
+        return af::array(d, static_cast<const unsigned char *>(data));
+    case b8:
+        return af::array(d, static_cast<const unsigned char *>(data)).as(b8);
+    }
+    return af::array();
+}
+
+bool volumeCache::lookup(uint64_t key, af::array &x) {
+    if (!enabled())
+        return false;
+    std::string path = entryPath(key);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        misses++;
+        return false;
+    }
+    struct stat st;
+    st.st_size = 0;
+    bool ok = (fstat(fd, &st) == 0)
+            && (static_cast<size_t>(st.st_size) >= sizeof(volumeHeader));
+    void *map = MAP_FAILED;
+    if (ok) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = (map != MAP_FAILED);
+    }
+    close(fd);
+    if (ok) {
+        const volumeHeader *h = static_cast<const volumeHeader *>(map);
+        ok = (memcmp(h->magic, "IMVC", 4) == 0)
+                && (h->version == VOLUME_CACHE_VERSION) && (h->key == key)
+                && (sizeof(volumeHeader) + h->bytes
+                        == static_cast<uint64_t>(st.st_size));
+        if (ok) {
+            // the host to device copy reads straight from the mapping
+            x = arrayFromHost(*h, static_cast<const char *>(map)
+                    + sizeof(volumeHeader));
+            ok = !x.isempty();
+        }
+        munmap(map, st.st_size);
+    }
+    if (!ok) {
+        // truncated or stale entry
+        if (unlink(path.c_str()) == 0 && scanned)
+            totalBytes -= std::min(totalBytes, static_cast<size_t>(st.st_size));
+        misses++;
+        return false;
+    }
+    // mark as recently used, access times are often not maintained
+    utimes(path.c_str(), NULL);
+    hits++;
+    return true;
+}
+
+void volumeCache::store(uint64_t key, const af::array &x) {
+    if (!enabled() || x.isempty())
+        return;
+    af::dtype t = x.type();
+    if (t != f32 && t != f64 && t != c32 && t != c64 && t != u8 && t != b8) {
+        cout << "volumeCache: unsupported array type " << t << endl;
+        return;
+    }
+    volumeHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "IMVC", 4);
+    h.version = VOLUME_CACHE_VERSION;
+    h.key = key;
+    for (int i = 0; i < 4; i++)
+        h.dims[i] = x.dims()[i];
+    h.type = t;
+    h.bytes = x.bytes();
+    std::vector<char> data(h.bytes);
+    x.host(&data[0]);
+
+    // write to a temporary name and rename, so concurrent runs never see a
+    // partial entry
+    std::string path = entryPath(key);
+    std::string tmp = path + "." + hashString(getpid());
+    struct stat old;
+    size_t replaced = (stat(path.c_str(), &old) == 0) ? old.st_size : 0;
+    ofstream out(tmp.c_str(), ios::out | ios::binary);
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(&data[0], data.size());
+    out.close();
+    if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+        cout << "volumeCache: could not write " << path << endl;
+        unlink(tmp.c_str());
+        return;
+    }
+    if (!scanned) {
+        // the first store sizes the directory, entries of earlier runs
+        // included
+        evict();
+        return;
+    }
+    totalBytes -= std::min(replaced, totalBytes);
+    totalBytes += sizeof(h) + h.bytes;
+    if (totalBytes > maxBytes)
+        evict();
+}
+
+af::array volumeCache::fetch(uint64_t key, std::function<af::array()> compute) {
+    af::array x;
+    if (lookup(key, x))
+        return x;
+    x = compute();
+    store(key, x);
+    return x;
+}
+
+void volumeCache::evict() {
+    if (!enabled())
+        return;
+    DIR *dir = opendir(directory.c_str());
+    if (dir == NULL)
+        return;
+    // (modification time, size, path) of every entry
+    std::vector<std::pair<time_t, std::pair<size_t, std::string> > > entries;
+    size_t total = 0;
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL) {
+        std::string name(e->d_name);
+        if (name.size() < 4 || name.compare(name.size() - 4, 4, ".vol") != 0)
+            continue;
+        std::string path = directory + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        entries.push_back(
+                std::make_pair(st.st_mtime,
+                        std::make_pair(static_cast<size_t>(st.st_size), path)));
+        total += st.st_size;
+    }
+    closedir(dir);
+    if (total > maxBytes) {
+        std::sort(entries.begin(), entries.end()); // oldest first
+        for (size_t i = 0; i < entries.size() && total > maxBytes; i++) {
+            if (unlink(entries[i].second.second.c_str()) == 0)
+                total -= entries[i].second.first;
+        }
+    }
+    totalBytes = total;
+    scanned = true;
+}
+
+volumeCache &toolLibraryCache() {
+    static volumeCache *cache = NULL;
+    if (cache == NULL) {
+        const char *dir = getenv("IMSENSE_TOOL_CACHE");
+        const char *mb = getenv("IMSENSE_TOOL_CACHE_MB");
+        size_t maxBytes = static_cast<size_t>(mb ? atol(mb) : 4096) << 20;
+        cache = new volumeCache(dir ? dir : "", maxBytes);
+    }
+    return *cache;
+}
+
+bool cacheToolSpectra() {
+    const char *env = getenv("IMSENSE_TOOL_CACHE_SPECTRA");
+    return env && atoi(env) != 0;
+}
+
+uint64_t rotatedToolKey(uint64_t toolHash, const double *R, int interpolation) {
+    // rotations that agree to ~1e-9 share an entry
+    uint64_t h = hashRotation(R, hashValue(toolHash));
+    return hashValue(interpolation, h);
+}
+
+uint64_t toolSpectrumKey(uint64_t rotatedKey, af::dim4 fftShape) {
+    uint64_t h = hashValue(rotatedKey, fnv1a("spectrum", 8));
+    for (int i = 0; i < 4; i++)
+        h = hashValue(static_cast<long long>(fftShape[i]), h);
+    return h;
+}
@@ -0,0 +1,71 @@
+/*
+ * volumeCache.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef VOLUMECACHE_H_
+#define VOLUMECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <arrayfire.h>
+
+class volumeCache {
+    /*
+     * On disk store of arrays keyed by a 64 bit content hash (see
+     * contentHash.h). Each entry is one file, <key>.vol, holding a small
+     * header and the raw array; entries are mapped with mmap on lookup and
+     * the least recently used ones are removed once the directory grows
+     * past maxBytes. The size of the directory is scanned once, on the first
+     * store, and then kept as a running total, so stores only rescan it when
+     * the total passes maxBytes. A cache with an empty directory is
+     * disabled: lookups miss and stores do nothing.
+     */
+public:
+    volumeCache(std::string directory, size_t maxBytes);
+
+    bool enabled() const {
+        return !directory.empty();
+    }
+    // load an entry into x, false on a miss
+    bool lookup(uint64_t key, af::array &x);
+    // write an entry (f32, f64, c32, c64, u8 or b8 arrays)
+    void store(uint64_t key, const af::array &x);
+    // the cached array for key, computed and stored on a miss
+    af::array fetch(uint64_t key, std::function<af::array()> compute);
+    // scan the directory and remove least recently used entries until the
+    // cache fits in maxBytes; resets the running total
+    void evict();
+
+    long hits, misses;
+
+private:
+    std::string directory;
+    size_t maxBytes;
+    // bytes in the directory as of the last scan plus later stores, valid
+    // once scanned is set
+    size_t totalBytes;
+    bool scanned;
+    std::string entryPath(uint64_t key) const;
+};
+
+// The tool library cache shared by the orientation sweeps. It lives in the
+// directory given by the IMSENSE_TOOL_CACHE environment variable, is limited
+// to IMSENSE_TOOL_CACHE_MB megabytes (default 4096) and is disabled if the
+// variable is not set.
+volumeCache &toolLibraryCache();
+// Whether the tool library cache also keeps the spectra of rotated tools.
+// A spectrum is the c32 fft of the padded correlation grid, far larger than
+// the tool and specific to the part's grid size, so it is only cached if
+// IMSENSE_TOOL_CACHE_SPECTRA is set to a non zero value.
+bool cacheToolSpectra();
+
+// key of a tool rotated by R and resampled with an interpolation mode
+uint64_t rotatedToolKey(uint64_t toolHash, const double *R, int interpolation);
+// key of the spectrum of a rotated tool zero padded to an fft shape
+uint64_t toolSpectrumKey(uint64_t rotatedKey, af::dim4 fftShape);
+
+#endif /* VOLUMECACHE_H_ */
@@ -0,0 +1,317 @@
+/*
+ * voxelize.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "voxelize.h"
+
+using namespace std;
+
+triangleSoup readSTL(string filespec) {
+    // read an stl mesh into a triangle soup. Binary files are recognized by
+    // their size matching the triangle count in the header, since plenty of
+    // binary exporters also start the header with "solid".
+    ifstream input(filespec.c_str(), ios::in | ios::binary);
+    if (!input) {
+        cout << "Unable to open stl file " << filespec << endl;
+        exit(1); // terminate with error
+    }
+    input.seekg(0, ios::end);
+    size_t fileSize = static_cast<size_t>(input.tellg());
+    input.seekg(0, ios::beg);
+
+    triangleSoup triangles;
+    char header[80];
+    uint32_t ntriangles = 0;
+    if (fileSize >= 84) {
+        input.read(header, 80);
+        input.read(reinterpret_cast<char*>(&ntriangles), 4);
+    }
+
+    if (fileSize >= 84 && fileSize == 84 + 50 * static_cast<size_t>(ntriangles)) {
+        // binary stl -- normal, three vertices and an attribute per triangle
+        triangles.reserve(3 * ntriangles);
+        char record[50];
+        for (uint32_t t = 0; t < ntriangles; t++) {
+            input.read(record, 50);
+            float v[9];
+            std::copy(record + 12, record + 48, reinterpret_cast<char*>(v));
+            for (int i = 0; i < 3; i++) {
+                triangles.push_back(
+                        Eigen::Vector3d(v[3 * i], v[3 * i + 1], v[3 * i + 2]));
+            }
+        }
+    } else {
+        // ascii stl -- only the vertex lines matter
+        input.seekg(0, ios::beg);
+        string line;
+        while (getline(input, line)) {
+            std::istringstream iss(line);
+            string keyword;
+            iss >> keyword;
+            if (keyword.compare("vertex") == 0) {
+                double x, y, z;
+                iss >> x >> y >> z;
+                triangles.push_back(Eigen::Vector3d(x, y, z));
+            }
+        }
+        if (triangles.size() % 3 != 0) {
+            cout << "  malformed stl file " << filespec << endl;
+            exit(1);
+        }
+    }
+    input.close();
+    return triangles;
+}
+
+static bool triangleBoxOverlap(const Eigen::Vector3d &center,
+        const Eigen::Vector3d &half, const Eigen::Vector3d &a,
+        const Eigen::Vector3d &b, const Eigen::Vector3d &c) {
+    // separating axis test between a triangle and an axis aligned box
+    // (Akenine-Moller): box normals, triangle normal and the 9 edge cross products
+    Eigen::Vector3d v[3] = { a - center, b - center, c - center };
+
+    for (int q = 0; q < 3; q++) {
+        double lo = std::min(v[0][q], std::min(v[1][q], v[2][q]));
+        double hi = std::max(v[0][q], std::max(v[1][q], v[2][q]));
+        if (lo > half[q] || hi < -half[q])
+            return false;
+    }
+
+    Eigen::Vector3d e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+    for (int i = 0; i < 3; i++) {
+        for (int q = 0; q < 3; q++) {
+            Eigen::Vector3d axis = Eigen::Vector3d::Unit(q).cross(e[i]);
+            double p0 = axis.dot(v[0]);
+            double p1 = axis.dot(v[1]);
+            double p2 = axis.dot(v[2]);
+            double r = half.dot(axis.cwiseAbs());
+            if (std::min(p0, std::min(p1, p2)) > r
+                    || std::max(p0, std::max(p1, p2)) < -r)
+                return false;
+        }
+    }
+
+    Eigen::Vector3d normal = e[0].cross(e[1]);
+    double r = half.dot(normal.cwiseAbs());
+    double s = normal.dot(v[0]);
+    return std::abs(s) <= r;
+}
+
+static void surfaceVoxels(const triangleSoup &triangles, int nx, int ny,
+        int nz, std::vector<unsigned char> &voxels) {
+    // conservative surface voxelization. Triangles are binned by the x layers
+    // they touch and each thread owns whole layers, so no two threads ever
+    // write the same voxel.
+    size_t nt = triangles.size() / 3;
+    std::vector<std::vector<unsigned int> > layers(nx);
+    for (size_t t = 0; t < nt; t++) {
+        const Eigen::Vector3d &a = triangles[3 * t];
+        const Eigen::Vector3d &b = triangles[3 * t + 1];
+        const Eigen::Vector3d &c = triangles[3 * t + 2];
+        int lo = std::max(0, (int) floor(std::min(a[0], std::min(b[0], c[0]))));
+        int hi = std::min(nx - 1, (int) floor(std::max(a[0], std::max(b[0], c[0]))));
+        for (int x = lo; x <= hi; x++)
+            layers[x].push_back(static_cast<unsigned int>(t));
+    }
+
+    // slightly enlarged boxes keep the test conservative for triangles
+    // lying exactly on voxel faces
+    Eigen::Vector3d half(0.5 + 1e-9, 0.5 + 1e-9, 0.5 + 1e-9);
+    size_t n2 = static_cast<size_t>(ny) * nz;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int x = 0; x < nx; x++) {
+        for (size_t k = 0; k < layers[x].size(); k++) {
+            unsigned int t = layers[x][k];
+            const Eigen::Vector3d &a = triangles[3 * t];
+            const Eigen::Vector3d &b = triangles[3 * t + 1];
+            const Eigen::Vector3d &c = triangles[3 * t + 2];
+            int ylo = std::max(0, (int) floor(std::min(a[1], std::min(b[1], c[1]))));
+            int yhi = std::min(ny - 1, (int) floor(std::max(a[1], std::max(b[1], c[1]))));
+            int zlo = std::max(0, (int) floor(std::min(a[2], std::min(b[2], c[2]))));
+            int zhi = std::min(nz - 1, (int) floor(std::max(a[2], std::max(b[2], c[2]))));
+            for (int z = zlo; z <= zhi; z++) {
+                for (int y = ylo; y <= yhi; y++) {
+                    size_t idx = y + static_cast<size_t>(z) * ny + x * n2;
+                    if (voxels[idx])
+                        continue;
+                    Eigen::Vector3d center(x + 0.5, y + 0.5, z + 0.5);
+                    if (triangleBoxOverlap(center, half, a, b, c))
+                        voxels[idx] = 1;
+                }
+            }
+        }
+    }
+}
+
+static bool topLeft(double ey, double ez) {
+    // tie breaking rule for column centers falling exactly on a shared edge,
+    // so that a crossing is counted by exactly one of the two triangles
+    return (ez < 0) || (ez == 0 && ey > 0);
+}
+
+static void parityFill(const triangleSoup &triangles, int nx, int ny, int nz,
+        std::vector<unsigned char> &voxels) {
+    // solid fill: cast a ray along x through every (y,z) voxel column center,
+    // collect the crossings with the mesh and fill between pairs of crossings.
+    // Triangles are binned by the z rows of column centers they cover and each
+    // thread owns whole rows.
+    size_t nt = triangles.size() / 3;
+    std::vector<std::vector<unsigned int> > rows(nz);
+    for (size_t t = 0; t < nt; t++) {
+        const Eigen::Vector3d &a = triangles[3 * t];
+        const Eigen::Vector3d &b = triangles[3 * t + 1];
+        const Eigen::Vector3d &c = triangles[3 * t + 2];
+        int lo = std::max(0,
+                (int) ceil(std::min(a[2], std::min(b[2], c[2])) - 0.5));
+        int hi = std::min(nz - 1,
+                (int) floor(std::max(a[2], std::max(b[2], c[2])) - 0.5));
+        for (int z = lo; z <= hi; z++)
+            rows[z].push_back(static_cast<unsigned int>(t));
+    }
+
+    size_t n2 = static_cast<size_t>(ny) * nz;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int z = 0; z < nz; z++) {
+        std::vector<std::vector<double> > crossings(ny);
+        double pz = z + 0.5;
+        for (size_t k = 0; k < rows[z].size(); k++) {
+            unsigned int t = rows[z][k];
+            Eigen::Vector3d a = triangles[3 * t];
+            Eigen::Vector3d b = triangles[3 * t + 1];
+            Eigen::Vector3d c = triangles[3 * t + 2];
+            // orient the (y,z) projection counter clockwise
+            double area = (b[1] - a[1]) * (c[2] - a[2])
+                    - (b[2] - a[2]) * (c[1] - a[1]);
+            if (area == 0)
+                continue; // parallel to the ray
+            if (area < 0) {
+                std::swap(b, c);
+                area = -area;
+            }
+            int ylo = std::max(0,
+                    (int) ceil(std::min(a[1], std::min(b[1], c[1])) - 0.5));
+            int yhi = std::min(ny - 1,
+                    (int) floor(std::max(a[1], std::max(b[1], c[1])) - 0.5));
+            for (int y = ylo; y <= yhi; y++) {
+                double py = y + 0.5;
+                // edge functions, each is twice the area of a sub-triangle
+                double w0 = (c[1] - b[1]) * (pz - b[2]) - (c[2] - b[2]) * (py - b[1]);
+                double w1 = (a[1] - c[1]) * (pz - c[2]) - (a[2] - c[2]) * (py - c[1]);
+                double w2 = (b[1] - a[1]) * (pz - a[2]) - (b[2] - a[2]) * (py - a[1]);
+                if (w0 < 0 || w1 < 0 || w2 < 0)
+                    continue;
+                if ((w0 == 0 && !topLeft(c[1] - b[1], c[2] - b[2]))
+                        || (w1 == 0 && !topLeft(a[1] - c[1], a[2] - c[2]))
+                        || (w2 == 0 && !topLeft(b[1] - a[1], b[2] - a[2])))
+                    continue;
+                double px = (w0 * a[0] + w1 * b[0] + w2 * c[0]) / area;
+                crossings[y].push_back(px);
+            }
+        }
+
+        for (int y = 0; y < ny; y++) {
+            std::vector<double> &xs = crossings[y];
+            if (xs.size() < 2)
+                continue;
+            std::sort(xs.begin(), xs.end());
+            for (size_t p = 0; p + 1 < xs.size(); p += 2) {
+                int lo = std::max(0, (int) ceil(xs[p] - 0.5));
+                int hi = std::min(nx - 1, (int) ceil(xs[p + 1] - 0.5) - 1);
+                for (int x = lo; x <= hi; x++)
+                    voxels[y + static_cast<size_t>(z) * ny + x * n2] = 1;
+            }
+        }
+    }
+}
+
+std::vector<unsigned char> voxelizeTriangles(const triangleSoup &triangles,
+        int nx, int ny, int nz, voxelizeMode mode) {
+    // Triangles are expected in voxel units, voxel (x,y,z) covers
+    // [x,x+1)*[y,y+1)*[z,z+1). The buffer index of voxel (x,y,z) is
+    // y + z*ny + x*ny*nz, the same ordering binvox uses.
+    std::vector<unsigned char> voxels(static_cast<size_t>(nx) * ny * nz, 0);
+    if (mode == VOXELIZE_SOLID) {
+        parityFill(triangles, nx, ny, nz, voxels);
+    }
+    // always add the surface so thin walls that no ray center hits survive
+    surfaceVoxels(triangles, nx, ny, nz, voxels);
+    return voxels;
+}
+
+std::vector<unsigned char> voxelizeTriangles(const triangleSoup &triangles,
+        int n, voxelizeMode mode) {
+    return voxelizeTriangles(triangles, n, n, n, mode);
+}
+
+af::array voxelizeSTL(string filespec, int n, Eigen::Matrix4d pose,
+        voxelizeMode mode, double voxelSize) {
+    // voxelize an stl mesh in process instead of going through binvox files
+    triangleSoup triangles = readSTL(filespec);
+    if (triangles.empty()) {
+        cout << "Error: no triangles in " << filespec << endl;
+        exit(1);
+    }
+
+    // pose the mesh and find its bounding box
+    Eigen::Affine3d transform(pose);
+    Eigen::Vector3d lo = Eigen::Vector3d::Constant(1e300);
+    Eigen::Vector3d hi = Eigen::Vector3d::Constant(-1e300);
+    for (size_t i = 0; i < triangles.size(); i++) {
+        triangles[i] = transform * triangles[i];
+        lo = lo.cwiseMin(triangles[i]);
+        hi = hi.cwiseMax(triangles[i]);
+    }
+
+    // map the mesh into voxel units. Like binvox, the bounding box minimum
+    // is the grid origin and its longest side fits an n^3 grid. With an
+    // explicit voxel size every axis gets as many voxels as the mesh spans
+    // instead, so nothing is cut off however large the mesh is.
+    int dims[3] = { n, n, n };
+    if (voxelSize <= 0) {
+        voxelSize = (hi - lo).maxCoeff() / n;
+        if (voxelSize <= 0) {
+            cout << "Error: degenerate mesh " << filespec << endl;
+            exit(1);
+        }
+    } else {
+        for (int a = 0; a < 3; a++) {
+            dims[a] = std::max(1, (int) ceil((hi[a] - lo[a]) / voxelSize - 1e-9));
+        }
+    }
+    for (size_t i = 0; i < triangles.size(); i++) {
+        triangles[i] = (triangles[i] - lo) / voxelSize;
+    }
+
+    std::vector<unsigned char> voxels = voxelizeTriangles(triangles, dims[0],
+            dims[1], dims[2], mode);
+
+    // same layout as read_binvox -- dims are (y, z, x)
+    af::array A = af::array(dims[1], dims[2], dims[0], voxels.data());
+    A = A.as(f32);
+    return A;
+}
+
+double stlVoxelSize(string filespec, int n) {
+    triangleSoup triangles = readSTL(filespec);
+    if (triangles.empty() || n <= 0) {
+        return 0;
+    }
+    Eigen::Vector3d lo = triangles[0], hi = triangles[0];
+    for (size_t i = 1; i < triangles.size(); i++) {
+        lo = lo.cwiseMin(triangles[i]);
+        hi = hi.cwiseMax(triangles[i]);
+    }
+    return (hi - lo).maxCoeff() / n;
+}
@@ -0,0 +1,48 @@
+/*
+ * voxelize.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef VOXELIZE_H_
+#define VOXELIZE_H_
+
+#include <string>
+#include <vector>
+#include <arrayfire.h>
+#include <Eigen/Geometry>
+#include <Eigen/Dense>
+
+enum voxelizeMode {
+    VOXELIZE_SURFACE, // conservative surface voxelization (every voxel the mesh touches)
+    VOXELIZE_SOLID    // surface voxels plus the interior filled by parity scanlines
+};
+
+// Triangle soup, three consecutive vertices per triangle
+typedef std::vector<Eigen::Vector3d> triangleSoup;
+
+// read an ascii or binary stl file
+triangleSoup readSTL(std::string filespec);
+
+// voxelize triangles (already in voxel units, grid spans [0,nx)*[0,ny)*[0,nz))
+// into an occupancy buffer laid out in binvox order, i.e. y fastest, then z,
+// then x.
+std::vector<unsigned char> voxelizeTriangles(const triangleSoup &triangles,
+        int nx, int ny, int nz, voxelizeMode mode);
+// the same on an n^3 grid
+std::vector<unsigned char> voxelizeTriangles(const triangleSoup &triangles,
+        int n, voxelizeMode mode);
+
+// voxelize an stl file after applying pose to the mesh. If voxelSize <= 0 the
+// posed mesh bounding box is fit to an n^3 grid like binvox does, otherwise
+// voxelSize (in mesh units) is used so parts and tools share a scale, and every
+// axis is as long as the mesh needs (n is then ignored). The result is an f32
+// indicator with the same layout as read_binvox; exits if the mesh is empty.
+af::array voxelizeSTL(std::string filespec, int n, Eigen::Matrix4d pose,
+        voxelizeMode mode, double voxelSize = 0);
+
+// the voxel size (in mesh units) that fits the longest side of the mesh
+// bounding box to n voxels, 0 for an empty or degenerate mesh
+double stlVoxelSize(std::string filespec, int n);
+
+#endif /* VOXELIZE_H_ */
@@ -14,28 +14,72 @@
 #include <iterator>
 #include <iomanip>      // std::setw
 #include "helper.h"
+#include "adaptiveSweep.h"
+#include "coverageSweep.h"
+#include "volumeCache.h"
+#include "contentHash.h"
+#include "resultStore.h"
+#include "roiWindow.h"
+#include "memoryArena.h"
+#include "rotateVolume.h"
 
 
 
+static uint64_t toolCacheHash(af::array tool) {
+	// content hash of the tool for the tool library cache, 0 if it is off
+	return toolLibraryCache().enabled() ? hashArray(tool) : 0;
+}
+
 af::array getMaxFeasibleSetPerOrientation(af::array obstacles, af::array tool,
-		angleAxis rotation) {
+		angleAxis rotation, uint64_t toolHash = 0) {
 	/*
 	 * get the contact space for an oriented tool. Doing this as
-	 * a separate function to avoid memory issues.
+	 * a separate function to avoid memory issues. The rotated tool
+	 * comes from the tool library cache if toolHash is set.
 	 */
 
 	bool correlate = true; // need cross correlation
 	float level = 0.0;
+	af::array rotated =
+			toolHash ?
+					rotateToolCached(tool, toolHash, rotation) :
+					rotateTool(tool, rotation);
 	af::array cfree =  (levelSet(
-			convolveAF2(obstacles,
-					rotate(tool, rotation.angle, true,
-							AF_INTERP_BICUBIC_SPLINE), correlate), level));
+			convolveAF(obstacles, rotated, correlate), level));
 	return (cfree);
 }
 
+static uint64_t resultStoreKey(af::array obstacles, af::array tool) {
+	// base key of the per orientation sets in the result store, 0 if it is
+	// off. Shared by all the sweeps below, they only differ in which
+	// orientations they evaluate. Salted like the rotated tool keys, so sets
+	// stored before the tools were padded for rotation are not reused.
+	if (!resultStoreCache().enabled()) {
+		return 0;
+	}
+	return hashValue(fnv1a("padded", 6),
+			sweepKey(obstacles, tool, 0.0, obstacles.type(), "feasibleSet"));
+}
+
+static af::array orientationFeasibleSet(af::array obstacles, af::array tool,
+		angleAxis rotation, uint64_t toolHash, uint64_t storeKey) {
+	// getMaxFeasibleSetPerOrientation through the result store
+	if (storeKey == 0) {
+		return getMaxFeasibleSetPerOrientation(obstacles, tool, rotation,
+				toolHash);
+	}
+	Eigen::Matrix3d R = rotationMatrix(rotation);
+	return storedOrientation(orientationKey(storeKey, R.data()), [&]() {
+		return getMaxFeasibleSetPerOrientation(obstacles, tool, rotation,
+				toolHash);
+	});
+}
+
 af::array maxFeasibleSet(af::array obstacles, af::array tool, af::array envelope) {
 
-	af::deviceGC();
+	if (!memoryArenaActive()) {
+		af::deviceGC();
+	}
 
 	// compute the maximal set where each point can be accessed by the tool
 	// (in at least one orientation) without colliding with obstacles.
@@ -44,17 +88,42 @@ af::array maxFeasibleSet(af::array obstacles, af::array tool, af::array envelope
 
 	assert(obstacles.numdims() == tool.numdims()); //inputs must be equi-dimensional
 
+	// only the envelope's bounding box (padded by the rotated tool's reach,
+	// rotateTool pads the tool before rotating it) is correlated, the field
+	// is zero outside the envelope anyway
+	roiWindow window = roiWindowFor(envelope, padForRotation(tool).dims());
+	obstacles = cropToWindow(obstacles, window);
+	envelope = cropToWindow(envelope, window);
+
 	int problemDimension = obstacles.numdims();
 	std::vector<angleAxis> rotations = getRotations(problemDimension);
 
 	af::array maxFeasible = constant(0, obstacles.dims(), f32);
 	int n = static_cast<int>(rotations.size()); //number of rotations
 
+	// a run with the same inputs and rotations returns the stored field,
+	// otherwise only orientations missing from the store are computed
+	uint64_t storeKey = resultStoreKey(obstacles, tool);
+	uint64_t resultKey = 0;
+	if (storeKey) {
+		std::vector<uint64_t> orientations;
+		for (int i = 0; i < n; i++) {
+			Eigen::Matrix3d R = rotationMatrix(rotations[i]);
+			orientations.push_back(orientationKey(storeKey, R.data()));
+		}
+		resultKey = sweepResultKey(storeKey, orientations);
+		af::array stored;
+		if (resultStoreCache().lookup(resultKey, stored)) {
+			cout << "maximal feasible set found in the result store" << endl;
+			return expandFromWindow(stored * envelope, window);
+		}
+	}
+
 	dim4 resultDim = obstacles.dims(); // convolution will not expand input size
-	int batchsize = getBatchSize(problemDimension, obstacles.dims()[0],
-			tool.dims()[0], resultDim[0]);
+	int batchsize = getBatchSize(obstacles.dims(), tool.dims(), resultDim);
 
 	cout <<"Batch size = " << batchsize <<  endl;
+	uint64_t toolHash = toolCacheHash(tool);
 	// see https://github.com/arrayfire/arrayfire/issues/1709
 	for (int i = 0; i < n; i++) { // can we gfor this?
 		// do cross correlation and return all voxels where the overlap
@@ -63,30 +132,167 @@ af::array maxFeasibleSet(af::array obstacles, af::array tool, af::array envelope
 		// convolveAF2 or AF3 depending on nearNet.numdims()
 
 		// IMPORTANT = ASSUME TOOL REFERENCE POINT IS AT IMAGE CENTER!!
-		maxFeasible += getMaxFeasibleSetPerOrientation(obstacles, tool, rotations[i]);
+		maxFeasible += orientationFeasibleSet(obstacles, tool, rotations[i],
+				toolHash, storeKey).as(f32);
 		//visualize2D(maxFeasible+envelope);
 
-
-		printGPUMemory();
-
+		// keep the jit tree to one orientation
 		af::eval(maxFeasible);
-		af::deviceGC();
-
-		if (n % (batchsize/100) == 0) {
-			// this is required to avoid memory blowup, see github link above
-			//cout << "*************************** evaluating *********************************" << endl;
-			af::eval(maxFeasible);
-			// periodically do garbage collection .. lame.
-			// AF has some bug with non-expanded convolution
+		if (!memoryArenaActive()) {
+			// this is required to avoid memory blowup with the default
+			// memory manager, see github link above. The arena recycles
+			// the buffers of one orientation for the next instead.
+			printGPUMemory();
 			af::deviceGC();
 		}
 	}
+	printMemoryArenaStats();
+
+	if (storeKey) {
+		resultStoreCache().store(resultKey, maxFeasible);
+		cout << "result store hits " << resultStoreCache().hits << " misses "
+				<< resultStoreCache().misses << endl;
+	}
 
 	//af_print(maxFeasible);
 	maxFeasible *= envelope; // intersect with the envelope (as a field)
 //
-	return maxFeasible;
+	return expandFromWindow(maxFeasible, window);
+
+}
+
+af::array maxFeasibleSetAdaptive(af::array obstacles, af::array tool,
+		af::array envelope, int coarseLevel, int maxLevel) {
+	/*
+	 * The feasible set of maxFeasibleSet, but the orientations are swept
+	 * coarse to fine: only the children of orientations that added new
+	 * feasible voxels inside the envelope are evaluated at the next level,
+	 * and the sweep stops once refining no longer grows the union. The
+	 * orientations come from the hierarchy, not getRotations: in 3d level 1
+	 * is the same 576 rotations, in 2d the angles are (i + 1/2) * 2pi /
+	 * (6 * 2^level) instead of 144 steps from 0, so the 2d sets agree only
+	 * up to the sampling.
+	 */
+	obstacles = indicator(obstacles);
+	tool = indicator(tool);
+	assert(obstacles.numdims() == tool.numdims()); //inputs must be equi-dimensional
+
+	// sweep only the envelope's bounding box, padded by the reach of the
+	// rotated tools
+	roiWindow window = roiWindowFor(envelope, padForRotation(tool).dims());
+	obstacles = cropToWindow(obstacles, window);
+	envelope = cropToWindow(envelope, window);
+
+	int problemDimension = obstacles.numdims();
+	orientationHierarchy hierarchy(problemDimension);
+	uint64_t toolHash = toolCacheHash(tool);
+	uint64_t storeKey = resultStoreKey(obstacles, tool);
+	uint64_t resultKey = 0;
+	if (storeKey) {
+		int parameters[] = { 1, coarseLevel, maxLevel };
+		resultKey = sweepResultKey(storeKey,
+				std::vector<int>(parameters, parameters + 3));
+		// the envelope decides which orientations are evaluated
+		resultKey = sweepResultKey(resultKey,
+				std::vector<uint64_t>(1, hashArray(envelope)));
+		af::array stored;
+		if (resultStoreCache().lookup(resultKey, stored)) {
+			cout << "adaptive feasible set found in the result store" << endl;
+			return expandFromWindow(stored.as(f32) * envelope, window);
+		}
+	}
+	adaptiveSweepResult sweep = adaptiveSweep(hierarchy, coarseLevel,
+			maxLevel, [&](int level, int index) {
+				angleAxis rotation;
+				Eigen::AngleAxisd aa(hierarchy.rotation(level, index));
+				rotation.angle = aa.angle();
+				rotation.axis = aa.axis();
+				if (problemDimension == 2) {
+					rotation.angle = hierarchy.angle(level, index);
+				}
+				return orientationFeasibleSet(obstacles, tool, rotation,
+						toolHash, storeKey);
+			}, obstacles.dims(), envelope);
 
+	cout << "Adaptive sweep computed " << sweep.evaluations
+			<< " correlations" << endl;
+	if (storeKey) {
+		resultStoreCache().store(resultKey, sweep.feasible);
+	}
+	// intersect with the envelope
+	return expandFromWindow(sweep.feasible.as(f32) * envelope, window);
+}
+
+af::array maxFeasibleSetCoverage(af::array obstacles, af::array tool,
+		af::array envelope, int coarseFactor, double minGain) {
+	/*
+	 * Same field as maxFeasibleSet, but the orientations are evaluated in
+	 * the greedy order of their expected coverage of the envelope (from a
+	 * correlation at 1/coarseFactor resolution), and the sweep stops as soon
+	 * as the envelope is covered or an orientation adds fewer than
+	 * minGain * |envelope| voxels. Orientations after that point cannot
+	 * change (or barely change) the feasible set.
+	 */
+	obstacles = indicator(obstacles);
+	tool = indicator(tool);
+	assert(obstacles.numdims() == tool.numdims()); //inputs must be equi-dimensional
+
+	// sweep only the envelope's bounding box, padded by the reach of the
+	// rotated tools
+	roiWindow window = roiWindowFor(envelope, padForRotation(tool).dims());
+	obstacles = cropToWindow(obstacles, window);
+	envelope = cropToWindow(envelope, window);
+
+	int problemDimension = obstacles.numdims();
+	std::vector<angleAxis> rotations = getRotations(problemDimension);
+	int n = static_cast<int>(rotations.size());
+
+	// obstacles and tool are coarsened conservatively, so the coarse
+	// estimate under-approximates the feasible positions
+	af::array coarseObstacles = coarsen(obstacles, coarseFactor).as(f64);
+	af::array coarseTool = coarsen(tool, coarseFactor).as(f64);
+	af::array coarseEnvelope = coarsen(envelope, coarseFactor) > 0;
+	uint64_t toolHash = toolCacheHash(tool);
+	uint64_t coarseToolHash = toolCacheHash(coarseTool);
+	uint64_t storeKey = resultStoreKey(obstacles, tool);
+	uint64_t resultKey = 0;
+	if (storeKey) {
+		int parameters[] = { 2, coarseFactor, static_cast<int>(minGain * 1e6) };
+		resultKey = sweepResultKey(storeKey,
+				std::vector<int>(parameters, parameters + 3));
+		// the envelope decides which orientations are evaluated
+		resultKey = sweepResultKey(resultKey,
+				std::vector<uint64_t>(1, hashArray(envelope)));
+		af::array stored;
+		if (resultStoreCache().lookup(resultKey, stored)) {
+			cout << "coverage field found in the result store" << endl;
+			return expandFromWindow(stored * envelope, window);
+		}
+	}
+
+	coverageSweepResult sweep = coverageSweep(n,
+			[&](int i) {
+				return getMaxFeasibleSetPerOrientation(coarseObstacles,
+						coarseTool, rotations[i], coarseToolHash) && coarseEnvelope;
+			}, [&](int i) {
+				return orientationFeasibleSet(obstacles, tool, rotations[i],
+						toolHash, storeKey);
+			}, obstacles.dims(), envelope, minGain);
+
+	cout << "orientations needed (index, angle, new voxels):" << endl;
+	for (size_t k = 0; k < sweep.used.size(); k++) {
+		cout << setw(6) << sweep.used[k] << setw(12)
+				<< rotations[sweep.used[k]].angle << setw(10) << sweep.gains[k]
+				<< endl;
+	}
+	if (!sweep.complete) {
+		cout << "envelope not fully covered" << endl;
+	}
+	if (storeKey) {
+		resultStoreCache().store(resultKey, sweep.count);
+	}
+	// intersect with the envelope (as a field)
+	return expandFromWindow(sweep.count * envelope, window);
 }
 
 void writeImages(af::array maxFeasible, af::array obstacles, af::array envelope, af::array envelopebd, af::array tool){
@@ -20,6 +20,19 @@ using namespace std;
 // compute the largest feasible set that the tool can reach
 af::array maxFeasibleSet(af::array obstacles, af::array tool, af::array envelope);
 
+// adaptive version, refines the orientation grid only where new feasible
+// voxels appear (inside the envelope) and returns the union as an indicator
+af::array maxFeasibleSetAdaptive(af::array obstacles, af::array tool,
+		af::array envelope, int coarseLevel, int maxLevel);
+
+// coverage ordered version, evaluates orientations in the order of their
+// estimated coverage of the envelope (at 1/coarseFactor resolution) and
+// stops once the envelope is covered or the gain drops below minGain
+// (a fraction of the envelope). Returns the same field as maxFeasibleSet,
+// summed over the orientations that were evaluated.
+af::array maxFeasibleSetCoverage(af::array obstacles, af::array tool,
+		af::array envelope, int coarseFactor, double minGain);
+
 // write images for visualization
 void writeImages(af::array maxFeasible, af::array obstacles, af::array envelope, af::array envelopebd, af::array tool);
 
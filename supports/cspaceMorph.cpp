@@ -75,3 +75,26 @@ array convolveAF2(array x, array y, bool correlate) {
 	}
 }
 
+array convolveAF(array x, array y, bool correlate) {
+	// pick the 2d or 3d convolution from the problem dimension
+	if (x.numdims() == 3) {
+		return convolveAF3(x, y, correlate);
+	}
+	return convolveAF2(x, y, correlate);
+}
+
+array coarsen(array x, int factor) {
+	// conservative downsampling: a coarse voxel is set if any of the
+	// factor^d fine voxels it replaces is set (max pooling)
+	if (factor <= 1) {
+		return x;
+	}
+	array support = (x > 0).as(f32);
+	if (x.numdims() == 3) {
+		array pooled = dilate3(support, constant(1, factor, factor, factor));
+		return pooled(seq(0, end, factor), seq(0, end, factor),
+				seq(0, end, factor));
+	}
+	array pooled = dilate(support, constant(1, factor, factor));
+	return pooled(seq(0, end, factor), seq(0, end, factor));
+}
@@ -16,10 +16,14 @@ using namespace af;
 array indicator(array x);
 array sublevel(array x, double measure);
 array sublevelComplement(array x, double measure);
+array reflect3(array x);
+array reflect2(array x);
 array convolveAF3(array x, array y, bool correlate);
 array convolveAF2(array x, array y, bool correlate);
+array convolveAF(array x, array y, bool correlate);
 array levelSet(array x, double measure);
 double volume(array x);
 array complement(array x);
+array coarsen(array x, int factor);
 
 #endif /* CSPACEMORPH_H_ */
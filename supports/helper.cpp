@@ -11,9 +11,23 @@
 #include <fstream>
 #include <iostream>
 #include <stdlib.h>
+#include <algorithm>
+#include <cmath>
 #include <arrayfire.h>
 #include "helper.h"
 #include "cspaceMorph.h"
+#include "renderQueue.h"
+#include "so3Grid.h"
+#include "rotateVolume.h"
+#include "volumeCache.h"
+#include "contentHash.h"
+
+// vtk is only used to write offscreen renders
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkPNGWriter.h>
 
 using namespace std;
 using namespace af;
@@ -164,33 +178,27 @@ double getAvailableDeviceMemory() {
 
 }
 
-int getBatchSize(int d, int partDim, int toolDim, int resultDim) {
+int getBatchSize(af::dim4 partDims, af::dim4 toolDims, af::dim4 resultDims) {
 	/*
 	 * Estimate how many convolutions can fit on the gpu. The set
 	 * of all convolutions that can fit on the gpu is the batch.
+	 * Sizes are the product over the axes, grids need not be cubic.
 	 */
 	//1. get allocatable memory (in bytes) available on the GPU
 	double mem = getAvailableDeviceMemory();
 	//2. estimate required memory for result and subtract from allocatable memory
-	mem -= (pow(static_cast<double>(resultDim), static_cast<double>(d))
-			* sizeof(f32));
+	mem -= static_cast<double>(resultDims.elements()) * sizeof(f32);
 	//3. estimate memory required for a single convolution
 	// Each convolution needs to hold the part, tool and result on the GPU
 	// TODO this is very inefficient because arrayfire stores the intermediate
 	// convolutions on the GPU and does not go out of scope until the loop
 	// exits. According to arrayfire this to avoid multiple reads and writes
 	// which would result in overall performance degradation.
-	double req = ceil(
-			pow(static_cast<double>(partDim), static_cast<double>(d))
-					* sizeof(f32));
+	double req = static_cast<double>(partDims.elements()) * sizeof(f32);
 	// add memory for the tool data separately in case part and tool input sizes differ
-	req += ceil(
-			pow(static_cast<double>(toolDim), static_cast<double>(d))
-					* sizeof(f32));
+	req += static_cast<double>(toolDims.elements()) * sizeof(f32);
 	// add memory to store the convolution too (can't seem to delete this on the fly)
-//	req += ceil(
-//			pow(static_cast<double>(resultDim), static_cast<double>(d))
-//					* sizeof(f32));
+//	req += static_cast<double>(resultDims.elements()) * sizeof(f32);
 	/*	cout << "Available memory (MB) = " << mem / (1024 * 1024)
 	 << " and memory required per batch (MB) = " << req / (1024 * 1024)
 	 << endl;*/
@@ -198,28 +206,16 @@ int getBatchSize(int d, int partDim, int toolDim, int resultDim) {
 }
 
 void checkInputs(af::array nearNet, af::array tool, af::array part) {
-	// check that the nearNet and tool arrays are valid inputs
+	// check that the nearNet and tool arrays are valid inputs. The grids
+	// may have a different size along every axis; tools need not be square
+	// since rotateTool pads them before rotating.
 
 	assert(nearNet.numdims() == tool.numdims()); // nearNet and tool must be equi-dimensional
 	assert(nearNet.numdims() == part.numdims()); // nearNet and part must be equi-dimensional
 	int d = nearNet.numdims(); // d-dimensional nearNet
 	assert(d == 2 || d == 3); // handling only 2 and 3-d.
-
-	if (d == 2) {
-		assert(nearNet.dims()[0] == nearNet.dims()[1]);
-		assert(tool.dims()[0] == tool.dims()[1]);
-		assert(part.dims()[0] == part.dims()[1]);
-	} else {
-		assert(
-				(nearNet.dims()[0] == nearNet.dims()[1])
-						&& (nearNet.dims()[0] == nearNet.dims()[2]));
-		assert(
-				(tool.dims()[0] == tool.dims()[1])
-						&& (tool.dims()[0] == tool.dims()[2]));
-		assert(
-				(part.dims()[0] == part.dims()[1])
-						&& (part.dims()[0] == part.dims()[2]));
-	}
+	// the part and the near net shape live on the same grid
+	assert(nearNet.dims() == part.dims());
 }
 
 std::vector<angleAxis> getRotations(int d) {
@@ -232,7 +228,7 @@ std::vector<angleAxis> getRotations(int d) {
 		int n = 144; // evaluate 2d c-scpace at 360/n degree increments
 		for (int i = 0; i < n; i++) {
 			angleAxis rot;
-			rot.angle = double(i * 360 / n);
+			rot.angle = 2 * M_PI * i / n; // radians, as rotateTool expects
 			rot.axis = Eigen::Vector3d(0, 0, 1); // assume rotation about z
 			// axis is irrelevant for 2d rotations
 			rotations.push_back(rot);
@@ -241,26 +237,12 @@ std::vector<angleAxis> getRotations(int d) {
 	}
 	case 3: {
 		cout << "sampling 3d rotations" << endl;
-		// not implemented yet -- use getRotationsFromFile in helper.h
-		ifstream rotationFile;
-		string filename = "576quaternions.dat";
-		rotationFile.open(filename.c_str(), ios::in | ios::binary);
-		if (!rotationFile) {
-			cout << "Unable to open rotation file" << endl;
-			exit(1); // terminate with error
-		}
-		string line;
-		while (getline(rotationFile, line)) {
-			std::istringstream iss(line);
-			string w, x, y, z;
-			iss >> w >> x >> y >> z;
-			double qw = atof(w.c_str());
-			double qx = atof(x.c_str());
-			double qy = atof(y.c_str());
-			double qz = atof(z.c_str());
-			Eigen::Quaterniond q(qw, qx, qy, qz);
+		// level 1 of the SO(3) grid, the same 576 rotations that used to be
+		// read from 576quaternions.dat
+		so3Grid grid = simpleSO3Grid(1);
+		for (int i = 0; i < grid.size(); i++) {
 			// convert the quaternion q to angle axis
-			Eigen::AngleAxisd aa(q);
+			Eigen::AngleAxisd aa(grid.quaternion(i));
 			angleAxis rot;
 			rot.angle = aa.angle();
 			rot.axis = aa.axis();
@@ -272,11 +254,83 @@ std::vector<angleAxis> getRotations(int d) {
 	return (rotations);
 }
 
+Eigen::Matrix3d rotationMatrix(angleAxis rotation) {
+	return Eigen::AngleAxisd(rotation.angle, rotation.axis.normalized()).toRotationMatrix();
+}
+
+af::array rotateTool(af::array tool, angleAxis rotation) {
+	// rotate the tool about the image center. 2d tools are rotated by the
+	// angle (radians) with bicubic interpolation, 3d tools by the full
+	// rotation with nearest neighbour sampling. Both rotate inside the
+	// grid, which is padded first so that no voxel is cropped; the rotated
+	// tool has the dims of padForRotation(tool).
+	tool = padForRotation(tool);
+	if (tool.numdims() == 3) {
+		return rotateVolume(tool, rotationMatrix(rotation));
+	}
+	return rotate(tool, rotation.angle, true, AF_INTERP_BICUBIC_SPLINE);
+}
+
+af::array rotateToolCached(af::array tool, uint64_t toolHash,
+		angleAxis rotation) {
+	// rotateTool through the tool library cache (a plain rotateTool if the
+	// cache is disabled). toolHash is hashArray(tool), computed once per sweep.
+	volumeCache &cache = toolLibraryCache();
+	if (!cache.enabled()) {
+		return rotateTool(tool, rotation);
+	}
+	Eigen::Matrix3d R = rotationMatrix(rotation);
+	int interpolation =
+			(tool.numdims() == 3) ? AF_INTERP_NEAREST : AF_INTERP_BICUBIC_SPLINE;
+	// entries from before the tools were padded have other keys
+	uint64_t key = hashValue(fnv1a("padded", 6),
+			rotatedToolKey(toolHash, R.data(), interpolation));
+	return cache.fetch(key, [&]() {return rotateTool(tool, rotation);});
+}
+
+static void writeImagePNG(unsigned char *pixels, int width, int height,
+		std::string filename) {
+	// write an 8 bit grayscale host image (column major, like arrayfire)
+	// through vtk, wrapping the buffer instead of copying it
+	vtkSmartPointer<vtkUnsignedCharArray> scalars = vtkSmartPointer<
+			vtkUnsignedCharArray>::New();
+	scalars->SetArray(pixels, static_cast<vtkIdType>(width) * height, 1);
+	vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+	image->SetDimensions(width, height, 1);
+	image->GetPointData()->SetScalars(scalars);
+	vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
+	writer->SetFileName(filename.c_str());
+	writer->SetInputData(image);
+	writer->Write();
+	af::freeHost(pixels);
+}
+
 void visualize2D(af::array a) {
 	// visualize a 2d arrayfire array
+	assert(a.numdims() == 2);
+	renderMode mode = getRenderMode();
+	if (mode == RENDER_NONE) {
+		return;
+	}
+	if (mode == RENDER_OFFSCREEN) {
+		// scale to 8 bits on the device, then hand the host copy to the
+		// render thread. Arrayfire images are column major and top row
+		// first while vtk images are row major and bottom row first.
+		af::array scaled = a.as(f32);
+		float top = af::max<float>(scaled);
+		if (top > 0) {
+			scaled = scaled * (255.f / top);
+		}
+		af::array pixels = af::flip(scaled, 0).T().as(u8);
+		int width = static_cast<int>(pixels.dims()[0]);
+		int height = static_cast<int>(pixels.dims()[1]);
+		unsigned char *host = pixels.host<unsigned char>();
+		std::string filename = nextRenderFilename("visualize2D");
+		enqueueRender([=]() {writeImagePNG(host, width, height, filename);});
+		return;
+	}
 	const static int width = 512, height = 512;
 	af::Window window(width, height, "2D plot example title");
-	assert(a.numdims() == 2);
 	do {
 		window.image(a);
 	} while (!window.close());
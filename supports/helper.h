@@ -8,6 +8,9 @@
 #ifndef HELPER_H_
 #define HELPER_H_
 
+#include <stdint.h>
+#include <vector>
+#include <Eigen/Dense>
 #include <arrayfire.h>
 #include <cuda.h>
 #include <cuda_runtime.h>
@@ -30,9 +33,13 @@ af::array read_binvox(std::string filespec);
 void printGPUMemory();
 
 double getAvailableDeviceMemory();
-int getBatchSize(int d, int partDim, int toolDim, int resultDim);
+int getBatchSize(af::dim4 partDims, af::dim4 toolDims, af::dim4 resultDims);
 void checkInputs(af::array nearNet, af::array tool, af::array part);
 std::vector<angleAxis> getRotations(int d);
 void visualize2D(af::array a);
+Eigen::Matrix3d rotationMatrix(angleAxis rotation);
+af::array rotateTool(af::array tool, angleAxis rotation);
+af::array rotateToolCached(af::array tool, uint64_t toolHash,
+		angleAxis rotation);
 
 #endif /* HELPER_H_ */
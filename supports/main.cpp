@@ -11,16 +11,18 @@
 #include "removeSupports.h"
 #include "computeMaxFeasibleSet.h"
 #include "helper.h"
+#include "renderQueue.h"
+#include "memoryArena.h"
 
 using namespace std;
 
 int main(int argc, char *argv[]) {
 	try {
-		if ((argc != 5)) {
+		if ((argc < 5) || (argc > 7)) {
 			cout << "Number of arguments = " << argc << endl;
 			cout << "usage = " << endl;
 			cout
-					<< "maximal set computation: ./analyzeCSpace obstaclesFile toolFile envelopeFile envelopeBoundaryFile \n"
+					<< "maximal set computation: ./analyzeCSpace obstaclesFile toolFile envelopeFile envelopeBoundaryFile [adaptiveMaxLevel] [coverageMinGain] \n"
 					<< endl;
 			//cout << "support removal ./analyzeCSpace nearNetFile toolFile partWithoutSupportsFile epsilon  \n" << endl;
 			exit(1);
@@ -29,6 +31,10 @@ int main(int argc, char *argv[]) {
 		// Select a device and display arrayfire info
 		af::setDevice(0);
 		af::info();
+		// recycle the buffers of the orientation loops (cpu backend)
+		if (useMemoryArena()) {
+			cout << "Using the memory arena" << endl;
+		}
 		/*
 		 if (argc == 5) {
 		 // REMOVE SUPPORTS
@@ -57,7 +63,7 @@ int main(int argc, char *argv[]) {
 		 runSupportRemoval(nearNet, tool, part, epsilon);
 		 }*/
 
-		if (argc == 5) {
+		if (argc >= 5) {
 			// COMPUTE MAXIMAL FEASIBLE SET
 			cout << "Computing maximal feasible set" << endl;
 			// physical obstacles indicator function
@@ -91,9 +97,28 @@ int main(int argc, char *argv[]) {
 			af::saveImage("initialConstraints.png",
 					complement(obstacles + envelopebd).as(f32));
 
-			af::array maxFeas = maxFeasibleSet(obstacles, tool, envelope);
-
-			af::array sublevelSet = sublevel(maxFeas, 40).as(f32);
+			af::array maxFeas;
+			af::array sublevelSet;
+			int maxLevel = (argc >= 6) ? atoi(argv[5]) : -1;
+			if (argc == 7) {
+				// coverage ordered sweep of the fixed orientation set, stops
+				// early once the envelope is covered (adaptiveMaxLevel is
+				// ignored). The counts only cover the orientations that were
+				// evaluated, so threshold the union rather than the field.
+				double minGain = atof(argv[6]);
+				maxFeas = maxFeasibleSetCoverage(obstacles, tool, envelope, 4,
+						minGain);
+				sublevelSet = indicator(maxFeas).as(f32);
+			} else if (maxLevel >= 0) {
+				// adaptive orientation refinement up to the given level,
+				// the result is already a set rather than a count field
+				maxFeas = maxFeasibleSetAdaptive(obstacles, tool, envelope, 0,
+						maxLevel);
+				sublevelSet = maxFeas;
+			} else {
+				maxFeas = maxFeasibleSet(obstacles, tool, envelope);
+				sublevelSet = sublevel(maxFeas, 40).as(f32);
+			}
 			visualize2D(sublevelSet);
 			af::saveImage("levelset.png", sublevelSet);
 
@@ -101,6 +126,9 @@ int main(int argc, char *argv[]) {
 			writeImages(maxFeas, obstacles, envelope, envelopebd,tool);
 		}
 
+		// let queued offscreen renders finish before exiting
+		waitForRenders();
+
 	} catch (af::exception& e) {
 		fprintf(stderr, "%s\n", e.what());
 		throw;
@@ -14,28 +14,29 @@
 #include <iterator>
 #include <iomanip>      // std::setw
 #include "helper.h"
+#include "labelStats.h"
+#include "memoryArena.h"
+#include "connectedComponents.h"
+#include "morphology.h"
+#include "rotateVolume.h"
 
 af::array getDilatedPart(af::array part, float kernelSize) {
 	// dilate the part -- useful for support intersections
+	// (separable box dilation, the cost does not grow with the kernel)
 	int d = part.numdims();
-	af::array dilatedPart;
-
-	if (d == 2) {
-		af::array mask = constant(1, kernelSize, kernelSize);
-		dilatedPart = dilate(part, mask);
-	} else {
-		af::array mask = constant(1, kernelSize, kernelSize, kernelSize);
-		dilatedPart = dilate3(part, mask);
-	}
+	int k = static_cast<int>(kernelSize);
+	af::array dilatedPart = boxDilate(part, k, k, (d == 2) ? 1 : k);
 	return (dilatedPart);
 }
 
 af::array getSupportComponents(af::array supports) {
-	//get connected components -- need to cast input to b8 (binary 8 bit)
 	// connected components will identify each support individually and label them.
-	af::array components = af::regions(supports.as(b8), AF_CONNECTIVITY_8);
-	// TODO -- add connected components code in 3d
-	return (components);
+	// 8-connectivity in 2d and 26-connectivity in 3d, labelled on the host
+	// from the bit-packed supports
+	int connectivity = (supports.numdims() == 3) ? 26 : 8;
+	labelledVolume components = labelComponents(bitVolume(supports),
+			connectivity);
+	return (components.toArray());
 }
 
 af::array getDislocationFeatures(af::array dilatedPart, af::array supports) {
@@ -59,9 +60,8 @@ af::array getEpsilonContactSpace(af::array nearNet, af::array tool,
 	 */
 	bool correlate = true; // need cross correlation
 	return (sublevelComplement(
-			convolveAF2(nearNet,
-					rotate(tool, rotation.angle, true,
-							AF_INTERP_BICUBIC_SPLINE), correlate), epsilon));
+			convolveAF(nearNet, rotateTool(tool, rotation), correlate),
+			epsilon));
 }
 
 af::array getProjectedContactCSpace(af::array nearNet, af::array tool,
@@ -78,10 +78,8 @@ af::array getProjectedContactCSpace(af::array nearNet, af::array tool,
 	af::array projectedContactCSpace = constant(0, nearNet.dims(), f32);
 	int n = static_cast<int>(rotations.size()); //number of rotations
 
-	int d = tool.numdims(); // problem dimension
 	dim4 resultDim = nearNet.dims(); // convolution will not expand input size
-	int batchsize = getBatchSize(d, nearNet.dims()[0], tool.dims()[0],
-			resultDim[0]);
+	int batchsize = getBatchSize(nearNet.dims(), tool.dims(), resultDim);
 
 	af::timer::start();
 
@@ -95,7 +93,10 @@ af::array getProjectedContactCSpace(af::array nearNet, af::array tool,
 				rotations[i], epsilon);
 		//printGPUMemory();
 
-		if (n % batchsize == 0) {
+		// after every batch of orientations; a device too small for one
+		// batch collects after every orientation
+		bool batchDone = (batchsize <= 0) || ((i + 1) % batchsize == 0);
+		if (!memoryArenaActive() && batchDone) {
 			// this is required to avoid memory blowup, see github link above
 			af::eval(projectedContactCSpace);
 			// periodically do garbage collection .. lame.
@@ -109,6 +110,80 @@ af::array getProjectedContactCSpace(af::array nearNet, af::array tool,
 
 }
 
+contactSpaceState initContactSpace(af::array nearNet, af::array tool,
+		std::vector<angleAxis> rotations, float epsilon) {
+	/*
+	 * Compute and keep the overlap field of every rotation, from which the
+	 * projected contact space follows. Falls back to recomputing the
+	 * projection in every recursion if the fields do not fit on the device.
+	 */
+	contactSpaceState cspace;
+	cspace.epsilon = epsilon;
+	int n = static_cast<int>(rotations.size()); //number of rotations
+	double required = static_cast<double>(nearNet.elements()) * n * sizeof(float);
+	cspace.incremental = (nearNet.numdims() == 2)
+			&& (required < getAvailableDeviceMemory() / 2);
+	if (!cspace.incremental) {
+		cout << "Overlap fields do not fit on the device, the contact space"
+				<< " is recomputed in every iteration" << endl;
+		cspace.projected = getProjectedContactCSpace(nearNet, tool, rotations,
+				epsilon);
+		return cspace;
+	}
+
+	af::timer::start();
+	dim4 toolDim = padForRotation(tool).dims(); // that of the rotated tools
+	cspace.reflectedTools = af::array(toolDim[0], toolDim[1], n, f32);
+	cspace.overlap = af::array(nearNet.dims()[0], nearNet.dims()[1], n, f32);
+	for (int i = 0; i < n; i++) {
+		af::array rotated = rotateTool(tool, rotations[i]);
+		bool correlate = true; // need cross correlation
+		cspace.overlap(span, span, i) = convolveAF2(nearNet, rotated, correlate);
+		cspace.reflectedTools(span, span, i) = reflect2(rotated);
+		af::eval(cspace.overlap, cspace.reflectedTools);
+	}
+	cspace.projected = sum(
+			sublevelComplement(cspace.overlap, epsilon).as(f32), 2);
+	af::eval(cspace.projected);
+	cout << "Done computing overlap fields in  " << af::timer::stop()
+			<< " s" << endl;
+	return cspace;
+}
+
+void removeFromContactSpace(contactSpaceState &cspace, af::array support) {
+	if (!cspace.incremental) {
+		return;
+	}
+	// bounding box of the support grown by the tool size; outside of it the
+	// correlation of the support with any rotated tool is zero, and inside
+	// it cropping the support loses nothing
+	af::array mask = support > 0;
+	af::array rows = af::where(anyTrue(mask, 1));
+	af::array cols = af::where(anyTrue(mask, 0));
+	if (rows.isempty()) {
+		return;
+	}
+	dim4 dims = cspace.overlap.dims();
+	int m0 = cspace.reflectedTools.dims()[0];
+	int m1 = cspace.reflectedTools.dims()[1];
+	int r0 = std::max(0, min<int>(rows) - m0);
+	int r1 = std::min<int>(dims[0] - 1, max<int>(rows) + m0);
+	int c0 = std::max(0, min<int>(cols) - m1);
+	int c1 = std::min<int>(dims[1] - 1, max<int>(cols) + m1);
+	af::seq wr(r0, r1), wc(c0, c1);
+
+	// the correlation with all rotated tools in one batched call
+	af::array delta = convolve2(support(wr, wc).as(f32), cspace.reflectedTools,
+			AF_CONV_DEFAULT, AF_CONV_AUTO);
+	af::array before = cspace.overlap(wr, wc, span);
+	af::array after = before - delta;
+	cspace.projected(wr, wc) += sum(
+			sublevelComplement(after, cspace.epsilon).as(f32)
+					- sublevelComplement(before, cspace.epsilon).as(f32), 2);
+	cspace.overlap(wr, wc, span) = after;
+	af::eval(cspace.overlap, cspace.projected);
+}
+
 void peels(std::vector<std::vector<int> > L, unsigned int nSupports) {
 	if (L.empty()) {
 		cout << "None of the supports are accessible" << endl;
@@ -135,7 +210,7 @@ void peels(std::vector<std::vector<int> > L, unsigned int nSupports) {
 double getRerror(af::array a, af::array b, int d) {
 	// This is a way of checking whether two indicator functions are approx equal
 	double error = count(af::where(a - b)).scalar<int>();
-	double rerror = error / ((double) pow(a.dims()[0], d)); // relative error
+	double rerror = error / ((double) a.elements()); // relative error
 	return rerror;
 }
 
@@ -155,7 +230,8 @@ std::vector<T> flatten(const std::vector<std::vector<T>>& v) {
 std::vector<std::vector<int> > removeSupports(af::array nearNet, af::array tool,
 		af::array part, af::array components, af::array dislocations,
 		std::vector<angleAxis> rotations, float epsilon,
-		std::vector<std::vector<int> > L, int nSupports, int count) {
+		std::vector<std::vector<int> > L, int nSupports, int count,
+		contactSpaceState &cspace) {
 	/*
 	 * Recursive algorithm to remove supports
 	 * L is the vector of maximally removable supports
@@ -169,23 +245,24 @@ std::vector<std::vector<int> > removeSupports(af::array nearNet, af::array tool,
 		return L; // all supports are removed
 	}
 
-	// Compute the projected contact space
-	af::array piContactCSpace = getProjectedContactCSpace(nearNet, tool,
-			rotations, epsilon);
+	// The projected contact space, kept up to date by removeFromContactSpace
+	// or recomputed if the overlap fields could not be kept
+	if (!cspace.incremental && count > 0) {
+		cspace.projected = getProjectedContactCSpace(nearNet, tool, rotations,
+				epsilon);
+	}
+	af::array piContactCSpace = cspace.projected;
 
 	af::eval(piContactCSpace);
 	// Now check if the trimmed projection contains some dislocation features.
 	// To do this, check where the trimmed projection function intersects the
-	// dislocation features.
-	af::array accessibleDislocations = piContactCSpace * dislocations;
-	af::array removableSupports = setUnique(
-			components(af::where(accessibleDislocations))).as(f32);
-	int n = removableSupports.dims()[0]; // number of removable supports
-
-	if (n == 0) {
-		peels(L, nSupports); // print
-		return L;
-	}
+	// dislocation features. A single labelled histogram over the components
+	// counts the dislocation pixels of every support (class 1 inaccessible,
+	// class 2 accessible) instead of a few full-size passes per support.
+	af::array dislocated = dislocations > 0;
+	af::array accessible = (piContactCSpace > 0) && dislocated;
+	std::vector<unsigned> h = labelHistogram(components,
+			dislocated.as(f32) + accessible.as(f32), nSupports, 3);
 
 	// only remove supports unique to this iteration -- there may be crud leftover
 	// from previous support removals, but as long as they are within atol, we assume
@@ -194,8 +271,14 @@ std::vector<std::vector<int> > removeSupports(af::array nearNet, af::array tool,
 	set<int> sL(iL.begin(), iL.end()); // make iL into a set and remove duplicates
 	// sL is the index set of all supports removed prior to this iteration
 	set<int> iR; // index set of candidate removable supports in this iteration
-	for (int i = 0; i < n; i++) {
-		iR.insert((int) removableSupports(i).scalar<float>());
+	for (int k = 1; k <= nSupports; k++) {
+		if (h[3 * k + 2] > 0) {
+			iR.insert(k); // some of its dislocation is accessible
+		}
+	}
+	if (iR.empty()) {
+		peels(L, nSupports); // print
+		return L;
 	}
 	set<int> U; // uniquely removable supports
 	std::set_difference(iR.begin(), iR.end(), sL.begin(), sL.end(),
@@ -203,23 +286,18 @@ std::vector<std::vector<int> > removeSupports(af::array nearNet, af::array tool,
 
 	// each support often has multiple components, make sure they are all removed.
 	std::vector<int> R; // all supports removable in this iteration of the recursion
+	double domain = static_cast<double>(nearNet.elements());
 	for (auto iter = U.begin(); iter != U.end(); iter++) {
-		// removableSupports(i) is an array and needs to be converted to a float
 		int supportNum = *iter;
-		af::array singleSupport = indicator(components == supportNum);
-		// find the dislocation for this support
-		af::array dislocation = singleSupport * dislocations;
-		// find the accessible dislocation from the C-obstacle
-		af::array accessibleDislocation = singleSupport
-				* accessibleDislocations;
-
-		if (getRerror(dislocation, accessibleDislocation, d) < atol) {
+		// dislocation pixels of this support that are not accessible
+		double inaccessible = h[3 * supportNum + 1];
+		if (inaccessible / domain < atol) {
 			// excellent, the entire support is removable
 			R.push_back(supportNum);
+			af::array singleSupport = indicator(components == supportNum);
 			nearNet -= singleSupport; // subtract this support from the near-net shape
 			af::eval(nearNet);
-		} else {
-			continue; // not a removable support
+			removeFromContactSpace(cspace, singleSupport);
 		}
 	}
 	count += 1;
@@ -239,10 +317,13 @@ std::vector<std::vector<int> > removeSupports(af::array nearNet, af::array tool,
 //			af::saveImage(file, nearNet);
 //		}
 
-		visualize2D(nearNet);
+		if (nearNet.numdims() == 2) {
+			// there is no 3d render path, 3d peels are only reported
+			visualize2D(nearNet);
+		}
 		// recurse
 		removeSupports(nearNet, tool, part, components, dislocations, rotations,
-				epsilon, L, nSupports, count);
+				epsilon, L, nSupports, count, cspace);
 	}
 
 	// avoid C++ warning/error -- control reaches end of non-void function [-Wreturn-type]
@@ -279,9 +360,11 @@ void runSupportRemoval(af::array nearNet, af::array tool, af::array part,
 	int nSupports = max<int>(components);
 	int count = 0; // 0th recursion -- need numbering to save files ..
 	cout << "Number of supports to be removed =" << nSupports << endl;
+	contactSpaceState cspace = initContactSpace(nearNet, tool,
+			sampledRotations, epsilon);
 	removeSupports(nearNet, tool, part, components, dislocations,
 			sampledRotations, epsilon, maximallyRemovableSupports, nSupports,
-			count);
+			count, cspace);
 
 }
 
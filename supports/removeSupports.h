@@ -9,6 +9,7 @@
 #define REMOVESUPPORTS_H_
 
 #include "cspaceMorph.h"
+#include "helper.h"
 #include <Eigen/Geometry>
 #include <Eigen/Dense>
 #include <arrayfire.h>
@@ -23,6 +24,26 @@ struct dislocationFeature {
 	std::vector<int> indices;
 };
 
+struct contactSpaceState {
+	/*
+	 * Overlap fields of the near net shape with every rotated tool, kept
+	 * across the support removal recursion. Correlation is linear, so
+	 * removing a support only subtracts its correlation with the tools,
+	 * which is nonzero within a tool length of the support. The projected
+	 * contact space is updated in the same window.
+	 */
+	bool incremental; // false if the fields do not fit on the device
+	float epsilon;
+	af::array reflectedTools; // rotated, reflected tools stacked along dim 2
+	af::array overlap;        // overlap field of each rotation along dim 2
+	af::array projected;      // number of rotations in contact at each pixel
+};
+
+contactSpaceState initContactSpace(af::array nearNet, af::array tool,
+		std::vector<angleAxis> rotations, float epsilon);
+// subtract a support (full size indicator) from the overlap fields and the
+// projected contact space, working only in the window the support affects
+void removeFromContactSpace(contactSpaceState &cspace, af::array support);
 
 void runSupportRemoval(af::array nearNet, af::array tool,
 		af::array part, float epsilon);